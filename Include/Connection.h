@@ -10,6 +10,20 @@
 // SENT_TO_USE_TQUEUE Minimal probability will not activate the write event because Impl->IsWriting.compare_exchange_strong
 // #define SENT_TO_USE_TQUEUE
 
+// the send path coalesce queued messages into one gathered write, capped by buffer count and bytes
+#ifndef SEND_GATHER_MAX_BUFFERS
+#define SEND_GATHER_MAX_BUFFERS 64
+#endif // SEND_GATHER_MAX_BUFFERS
+#ifndef SEND_GATHER_MAX_BYTES
+#define SEND_GATHER_MAX_BYTES (256 * 1024)
+#endif // SEND_GATHER_MAX_BYTES
+
+// define macro RECV_USE_BUFFERED_READ (cmake option CORE_RECV_USE_BUFFERED_READ) to read into a per connection buffer with async_read_some
+// and parse every complete frame in one pass, frames bigger than the buffer are read into a dedicated message
+#ifndef RECV_BUFFER_SIZE
+#define RECV_BUFFER_SIZE (64 * 1024)
+#endif // RECV_BUFFER_SIZE
+
 
 class IConnectionOwner;
 
@@ -21,6 +35,55 @@ enum class ESocketState : uint32_t {
 	ConnectFailed,
 };
 
+struct FConnectionIoCounter
+{
+	// completed read or write operations
+	uint64_t OperationCounter;
+	uint64_t MessageCounter;
+	uint64_t ByteCounter;
+	double GetMessagesPerOperation() const { return OperationCounter ? double(MessageCounter) / OperationCounter : 0.0; }
+};
+
+// snapshot of the lock free counters of a connection, counters are read one by one and may be slightly out of step
+struct FConnectionStats
+{
+	FConnectionIoCounter Read;
+	FConnectionIoCounter Write;
+	// messages and bytes passed to Send and not written yet
+	uint64_t SendQueueMessages;
+	uint64_t SendQueueBytes;
+	uint64_t MaxSendQueueMessages;
+	uint64_t MaxSendQueueBytes;
+	// FLogClock nanoseconds of the last completed read or write, 0 when there is none
+	int64_t LastActivityTime;
+	// messages dropped or rejected by the slow consumer policy, TrySend rejections are not counted
+	uint64_t DroppedMessages;
+};
+
+// what Send do when the send queue is over the high water mark
+enum class ESlowConsumerPolicy : uint32_t {
+	// queue anyway, only TrySend is rejected
+	None,
+	// queue the new message and drop the oldest messages not being written
+	DropOldest,
+	// drop the new message, Send return 0
+	DropNewest,
+	// drop the new message and disconnect
+	Disconnect,
+};
+
+// the marks are soft limits, concurrent Send calls may overshoot them a little
+struct FSendQueueLimit
+{
+	// 0 disable the mark, a message is always accepted by an empty queue
+	uint64_t HighWaterMessages{ 0 };
+	uint64_t HighWaterBytes{ 0 };
+	// IConnectionOwner::OnConnectionWritable is called when a queue that reached the high water mark drain to both low marks
+	uint64_t LowWaterMessages{ 0 };
+	uint64_t LowWaterBytes{ 0 };
+	ESlowConsumerPolicy Policy{ ESlowConsumerPolicy::None };
+};
+
 // disable warning 4251
 #pragma warning(push)
 #pragma warning (disable: 4251)
@@ -98,16 +161,54 @@ public:
 
 	uint64_t Send(const FMessageData& MessageData);
 	uint64_t Send(FMessageData&& MessageData);
+	// the body of SharedMessageData is written by every connection it is sent to and must not be modified
+	uint64_t Send(std::shared_ptr<FMessageData> SharedMessageData);
+	// return the sequence number, or 0 without queueing when the send queue is over the high water mark
+	uint64_t TrySend(const FMessageData& MessageData);
+	uint64_t TrySend(FMessageData&& MessageData);
+	uint64_t TrySend(std::shared_ptr<FMessageData> SharedMessageData);
+
+	void SetSendQueueLimit(const FSendQueueLimit& SendQueueLimit);
+	FSendQueueLimit GetSendQueueLimit();
+	// false when the send queue is over the high water mark
+	bool IsWritable();
+
+	FConnectionIoCounter GetWriteCounter();
+	FConnectionIoCounter GetReadCounter();
+	// safe to call from any thread while the io threads keep running
+	FConnectionStats GetStats();
 
 protected:
 	virtual void OnErrorCode(const std::error_code& ErrorCode);
 	virtual void ReadHeader();
 	virtual void ReadBody();
+#ifdef SENT_TO_USE_TQUEUE
+	// one message at a time, header then body
 	virtual void WriteHeader();
 	virtual void WriteBody();
+#endif // SENT_TO_USE_TQUEUE
+	// read whatever the socket has into the recv buffer, used by RECV_USE_BUFFERED_READ
+	virtual void ReadSome();
+	// write as many queued messages as the gather limits allow with one async_write
+	virtual void WriteMessages();
 
 
 private:
+	// return false when the message must not be queued, apply the slow consumer policy unless IsTrySend
+	bool AdmitSend(uint64_t Bytes, bool IsTrySend);
+	uint64_t QueueSend(const FMessageData& MessageData);
+	uint64_t QueueSend(FMessageData&& MessageData);
+	uint64_t QueueSend(std::shared_ptr<FMessageData> SharedMessageData);
+	// called by the io thread after queued messages are written or dropped
+	void CheckWritable();
+	void ParseRecvBuffer();
+	void ReadLargeFrame(const uint8_t* Frame, uint32_t Available);
+	void ContinueRead();
+	// return false when the recv queue is full, reading continue after the message is delivered
+	bool DeliverMessage(FMessageData&& MessageData);
+#ifdef RECV_FROM_USE_RING_QUEUE
+	void WaitRecvQueue();
+#endif // RECV_FROM_USE_RING_QUEUE
 	void ConnectToServer();
 	void ConnectToClient();
 	void ConnectToRemote();
@@ -2,19 +2,65 @@
 #include <functional>
 #include <future>
 #include <memory>
+#include <span>
 #include "CoreApi.h"
 #include "Queue.h"
+#include "RingQueue.h"
 #include "Message.h"
+#include "Connection.h"
+
+// define macro RECV_FROM_USE_RING_QUEUE (cmake option CORE_RECV_FROM_USE_RING_QUEUE) to store received messages in a bounded ring queue,
+// when the queue is full the connection stop reading the socket until the owner thread drain it
+#ifdef RECV_FROM_USE_RING_QUEUE
+#ifndef RECV_FROM_RING_QUEUE_CAPACITY
+#define RECV_FROM_RING_QUEUE_CAPACITY 65536
+#endif // RECV_FROM_RING_QUEUE_CAPACITY
+typedef TRingQueue<FMessage, EQueueMode::MPSC> FRecvQueue;
+#else
+typedef TQueue<FMessage, EQueueMode::MPSC, EQueueNodeAllocator::Pool> FRecvQueue;
+#endif // RECV_FROM_USE_RING_QUEUE
 
 
 namespace asio {
 	class io_context;
 }
 
+enum class EIoContextMode : uint32_t {
+	// all io threads run one io context, connections serialize writes with a strand
+	Shared,
+	// one io context per io thread, a connection is pinned to one shard and need no strand
+	Sharded,
+};
+
+// how a sharded owner pick the shard of a new connection
+enum class EIoShardBalance : uint32_t {
+	RoundRobin,
+	LeastConnections,
+};
+
 // disable warning 4251
 #pragma warning(push)
 #pragma warning (disable: 4251)
 
+// aggregate of the connections of an owner
+struct FConnectionOwnerStats
+{
+	uint32_t ConnectionCount;
+	// include the connections already destroyed
+	FConnectionIoCounter Read;
+	FConnectionIoCounter Write;
+	// sum over the live connections
+	uint64_t SendQueueMessages;
+	uint64_t SendQueueBytes;
+	// largest max of the live connections
+	uint64_t MaxSendQueueMessages;
+	uint64_t MaxSendQueueBytes;
+	// include the connections already destroyed
+	uint64_t DroppedMessages;
+	// live connections by network name, sort them to find slow consumers or hot connections
+	std::vector<std::pair<std::string, FConnectionStats>> Connections;
+};
+
 class CORE_API FTcpServer
 {
 	struct FImpl;
@@ -52,7 +98,7 @@ public:
 public:
 	struct FImpl;
 
-	IConnectionOwner(uint32_t ThreadNumber = 0);
+	IConnectionOwner(uint32_t ThreadNumber = 0, EIoContextMode IoContextMode = EIoContextMode::Shared, EIoShardBalance IoShardBalance = EIoShardBalance::RoundRobin);
 	IConnectionOwner(const IConnectionOwner&) = delete;
 	IConnectionOwner(IConnectionOwner&& Other) = delete;
 	IConnectionOwner& operator=(const IConnectionOwner&) = delete;
@@ -60,23 +106,43 @@ public:
 	virtual ~IConnectionOwner();
 
 	asio::io_context& GetIoContext();
+	// io context for a new connection, OutIoShard is UINT32_MAX when not sharded
+	asio::io_context& AcquireIoContext(uint32_t& OutIoShard);
+	void ReleaseIoContext(uint32_t IoShard);
+	bool IsSharded();
 
 
-	TQueue<FMessage, EQueueMode::MPSC>& GetRecvQueue();
+	FRecvQueue& GetRecvQueue();
 	void IncreaseConnectionCounter();
 	void DecreaseConnectionCounter();
+	// fold the counters of a destroyed connection into the owner totals
+	void AddClosedConnectionStats(const FConnectionStats& Stats);
+
+	// read the lock free counters of every connection without stopping the io threads, must be called in owner thread
+	FConnectionOwnerStats GetStats();
 
 	void PushTask(std::function<void()>&& Task);
 	void ProcessTask();
 	uint32_t ProcessMessage();
+	// drain up to MaxBatch messages into a reusable buffer and dispatch them with one OnMessageBatch call
+	uint32_t ProcessMessage(uint32_t MaxBatch);
 	uint32_t ProcessEvent();
 
 	std::unordered_map<std::string, std::shared_ptr<SConnection>>& GetConnectionMap();
 
+	// copy MessageData once into a shared buffer and send it to every connection that pass Filter (all if Filter is empty),
+	// return the number of connections, must be called in owner thread
+	uint32_t Broadcast(const FMessageData& MessageData, const std::function<bool(const std::shared_ptr<SConnection>&)>& Filter = nullptr);
+	uint32_t Broadcast(FMessageData&& MessageData, const std::function<bool(const std::shared_ptr<SConnection>&)>& Filter = nullptr);
+
 protected:
 	virtual void OnMessage(std::shared_ptr<SConnection> ConnectionPtr, FMessageData& MessageData);
+	// default implementation call OnMessage for every message
+	virtual void OnMessageBatch(std::span<FMessage> Messages);
 	virtual void OnConnectionConnected(std::shared_ptr<SConnection> ConnectionPtr);
 	virtual void OnConnectionDisconnected(std::shared_ptr<SConnection> ConnectionPtr);
+	// the send queue of the connection drained below its low water marks after reaching the high water mark
+	virtual void OnConnectionWritable(std::shared_ptr<SConnection> ConnectionPtr);
 
 protected:
 	bool RunInOwnerThread();
@@ -91,7 +157,7 @@ class CORE_API CClient : public IConnectionOwner
 {
 	using Super = IConnectionOwner;
 public:
-	CClient(uint32_t ThreadNumber);
+	CClient(uint32_t ThreadNumber, EIoContextMode IoContextMode = EIoContextMode::Shared, EIoShardBalance IoShardBalance = EIoShardBalance::RoundRobin);
 
 	std::future<std::shared_ptr<SConnection>> ConnectToServer(std::string Address, uint16_t Port);
 	//void OnConnectionConnected(std::shared_ptr<SConnection> ConnectionPtr)
@@ -111,10 +177,12 @@ class CORE_API CServer : public IConnectionOwner
 {
 	using Super = IConnectionOwner;
 public:
-	CServer(uint32_t ThreadNumber = 0);
+	CServer(uint32_t ThreadNumber = 0, EIoContextMode IoContextMode = EIoContextMode::Shared, EIoShardBalance IoShardBalance = EIoShardBalance::RoundRobin);
 	virtual ~CServer();
 
-	void Run(uint16_t Port);
+	// NumAcceptors greater than one bind that many acceptors with SO_REUSEPORT (0 is one per io thread),
+	// every acceptor keep NumPendingAccepts accepts outstanding
+	void Run(uint16_t Port, uint32_t NumAcceptors = 1, uint32_t NumPendingAccepts = 1);
 	void WaitForClientConnection();
 	void Stop();
 protected:
@@ -130,7 +198,10 @@ protected:
 	//};
 
 
+	void WaitForClientConnection(uint32_t AcceptorIndex);
+
 	bool CheckRunCallOnce();
+	uint32_t PendingAcceptsPerAcceptor{ 1 };
 #ifndef NDEBUG
 	bool RunCallOnceFlag{ false };
 #endif // !NDEBUG
@@ -0,0 +1,74 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <cstdint>
+#include "CoreApi.h"
+#include "Logger.h"
+
+// "CLOG"
+#define LOG_FILE_MAGIC 0x474F4C43
+#define LOG_FILE_VERSION 1
+#define LOG_FILE_EXTENSION ".clog"
+
+// binary log segment layout:
+// FLogFileHeader, then FLogFileRecord followed by the message, until a record with zero size or the end of the file
+struct FLogFileHeader
+{
+	uint32_t Magic;
+	uint32_t Version;
+	// nanoseconds since epoch when the segment was opened
+	int64_t CreateTime;
+};
+
+struct FLogFileRecord
+{
+	// size of the record include this header and the padding, 8 bytes aligned
+	uint32_t RecordSize;
+	uint32_t LogLevel;
+	// nanoseconds since epoch
+	int64_t Timestamp;
+	uint64_t ThreadId;
+	uint32_t MessageSize;
+	uint32_t Reserve;
+};
+
+struct FLogFileSinkConfig
+{
+	std::string Directory{ "." };
+	std::string BaseName{ "Log" };
+	// bytes mapped for every segment, a new segment is opened when the current one is full
+	uint64_t SegmentSize{ 64 * 1024 * 1024 };
+	// open a new segment after this many seconds, 0 disable time based rotation
+	uint32_t RotationSeconds{ 3600 };
+};
+
+// disable warning 4251
+#pragma warning(push)
+#pragma warning (disable: 4251)
+
+// write records into pre-allocated memory mapped segments, decode them with the LogDecoder tool
+// segment files are named <BaseName>-<YYYYmmdd-HHMMSS>-<Index>.clog, the index keep lexical order
+class CORE_API CLogFileSink : public ILogSink
+{
+public:
+	CLogFileSink(const FLogFileSinkConfig& Config = FLogFileSinkConfig());
+
+	~CLogFileSink();
+
+	void Write(const FLogRecordHeader& Record, std::string_view Message) override;
+
+	void Flush() override;
+
+	// empty when no segment could be opened
+	std::string GetSegmentPath() const;
+
+protected:
+	bool OpenSegment(int64_t Timestamp);
+
+	void CloseSegment();
+
+	struct FImpl;
+	std::unique_ptr<FImpl> Impl;
+};
+
+#pragma warning(pop)
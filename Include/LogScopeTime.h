@@ -0,0 +1,146 @@
+#pragma once
+#include <bit>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <cstdint>
+#include "CoreApi.h"
+
+// define LOG_SCOPE_TIME_ENABLED to 0 to compile LOG_SCOPE_TIME out
+#ifndef LOG_SCOPE_TIME_ENABLED
+#define LOG_SCOPE_TIME_ENABLED 1
+#endif // LOG_SCOPE_TIME_ENABLED
+
+// max number of instrumented call sites, sites registered after the limit are not recorded
+#ifndef LOG_SCOPE_TIME_MAX_SITES
+#define LOG_SCOPE_TIME_MAX_SITES 1024
+#endif // LOG_SCOPE_TIME_MAX_SITES
+
+// "CSTP"
+#define LOG_SCOPE_TIME_MAGIC 0x50545343
+#define LOG_SCOPE_TIME_VERSION 1
+
+// static descriptor of an instrumented scope, registered once on first use
+struct CORE_API FLogScopeTimeSite
+{
+	FLogScopeTimeSite(const char* Name, const char* File, uint32_t Line);
+
+	const char* Name;
+	const char* File;
+	uint32_t Line;
+	// UINT32_MAX when the site limit is reached
+	uint32_t Index;
+};
+
+// log linear histogram of nanoseconds, 16 sub buckets per power of two (about 6% relative error)
+struct FLogScopeTimeHistogram
+{
+	static constexpr uint32_t kSubBucketBits = 4;
+	static constexpr uint32_t kSubBucketCount = 1 << kSubBucketBits;
+	static constexpr uint32_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBucketCount;
+
+	static uint32_t GetBucketIndex(uint64_t Value)
+	{
+		if (Value < kSubBucketCount)
+			return uint32_t(Value);
+		uint32_t Exponent = 63 - uint32_t(std::countl_zero(Value));
+		uint32_t SubBucket = uint32_t(Value >> (Exponent - kSubBucketBits)) & (kSubBucketCount - 1);
+		return (Exponent - kSubBucketBits + 1) * kSubBucketCount + SubBucket;
+	}
+
+	// middle of the bucket value range
+	static uint64_t GetBucketValue(uint32_t Index)
+	{
+		if (Index < kSubBucketCount)
+			return Index;
+		uint32_t Exponent = Index / kSubBucketCount + kSubBucketBits - 1;
+		uint64_t Lower = uint64_t(kSubBucketCount + Index % kSubBucketCount) << (Exponent - kSubBucketBits);
+		return Lower + (uint64_t(1) << (Exponent - kSubBucketBits)) / 2;
+	}
+
+	// only called by the owner thread, readers use relaxed loads
+	void Record(uint64_t Nanoseconds)
+	{
+		Count.store(Count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		Total.store(Total.load(std::memory_order_relaxed) + Nanoseconds, std::memory_order_relaxed);
+		if (Nanoseconds > Max.load(std::memory_order_relaxed))
+			Max.store(Nanoseconds, std::memory_order_relaxed);
+		std::atomic<uint64_t>& Bucket = Buckets[GetBucketIndex(Nanoseconds)];
+		Bucket.store(Bucket.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+
+	std::atomic<uint64_t> Count{ 0 };
+	std::atomic<uint64_t> Total{ 0 };
+	std::atomic<uint64_t> Max{ 0 };
+	std::atomic<uint64_t> Buckets[kBucketCount]{};
+};
+
+struct FLogScopeTimeStat
+{
+	const char* Name;
+	const char* File;
+	uint32_t Line;
+	uint64_t Count;
+	uint64_t Total;
+	uint64_t P50;
+	uint64_t P99;
+	uint64_t Max;
+};
+
+// every thread record into its own histograms, the profiler merge them when stats are collected
+class CORE_API FLogScopeTimeProfiler
+{
+public:
+	static void Record(const FLogScopeTimeSite& Site, uint64_t Nanoseconds);
+
+	// time of an asynchronous operation, called by its completion handler with the time it was issued
+	static void RecordSince(const FLogScopeTimeSite& Site, std::chrono::steady_clock::time_point Start)
+	{
+		Record(Site, uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - Start).count()));
+	}
+
+	// merge the histograms of every thread, values are in nanoseconds
+	static std::vector<FLogScopeTimeStat> CollectStats();
+
+	// one line per site: count, p50, p99, max in microseconds
+	static std::string DumpText();
+
+	// LOG_SCOPE_TIME_MAGIC, version, site count, then for every site
+	// name, file (uint32 size + characters), line, count, total, max, non empty bucket count, (uint32 index, uint64 count) pairs
+	static std::vector<uint8_t> DumpBinary();
+};
+
+// RAII timer of a scope, prefer LOG_SCOPE_TIME
+class CLogScopeTimeConsume
+{
+public:
+	CLogScopeTimeConsume(const FLogScopeTimeSite& Site)
+		: Site(Site)
+		, Start(std::chrono::steady_clock::now())
+	{
+	}
+
+	~CLogScopeTimeConsume()
+	{
+		FLogScopeTimeProfiler::RecordSince(Site, Start);
+	}
+
+private:
+	const FLogScopeTimeSite& Site;
+	std::chrono::steady_clock::time_point Start;
+
+	CLogScopeTimeConsume(const CLogScopeTimeConsume&) = delete;
+	CLogScopeTimeConsume& operator=(const CLogScopeTimeConsume&) = delete;
+};
+
+#define LOG_SCOPE_TIME_CONCAT_INNER(A, B) A##B
+#define LOG_SCOPE_TIME_CONCAT(A, B) LOG_SCOPE_TIME_CONCAT_INNER(A, B)
+
+#if LOG_SCOPE_TIME_ENABLED
+#define LOG_SCOPE_TIME(Name) \
+	static const FLogScopeTimeSite LOG_SCOPE_TIME_CONCAT(LogScopeTimeSite, __LINE__)(Name, __FILE__, __LINE__); \
+	CLogScopeTimeConsume LOG_SCOPE_TIME_CONCAT(LogScopeTimeConsume, __LINE__)(LOG_SCOPE_TIME_CONCAT(LogScopeTimeSite, __LINE__))
+#else
+#define LOG_SCOPE_TIME(Name)
+#endif // LOG_SCOPE_TIME_ENABLED
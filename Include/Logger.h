@@ -3,10 +3,52 @@
 #include <fstream>
 #include <functional>
 #include <future>
+#include <mutex>
+#include <condition_variable>
 #include <cassert>
+#include <unordered_map>
+#include <chrono>
+#include <algorithm>
+#include <cstring>
+#include <tuple>
+#include <iterator>
+#include <string_view>
+#include <type_traits>
 #include "Queue.h"
+#include "RingQueue.h"
 #include "CoreApi.h"
 #include "Core.h"
+#include "LogScopeTime.h"
+
+// repeated messages and rate limit drops are summarized at this interval in nanoseconds
+#ifndef LOG_SUPPRESSION_SWEEP_INTERVAL
+#define LOG_SUPPRESSION_SWEEP_INTERVAL (100 * 1000000)
+#endif // LOG_SUPPRESSION_SWEEP_INTERVAL
+// at most this many distinct messages are tracked by the dedup window, other messages are not deduplicated
+#ifndef LOG_SUPPRESSION_MAX_ENTRIES
+#define LOG_SUPPRESSION_MAX_ENTRIES 4096
+#endif // LOG_SUPPRESSION_MAX_ENTRIES
+
+// levels below LOG_COMPILE_MIN_LEVEL are removed from LOG_CATEGORY call sites at compile time
+#ifndef LOG_COMPILE_MIN_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_MIN_LEVEL ELogLevel::kInfo
+#else
+#define LOG_COMPILE_MIN_LEVEL ELogLevel::kTrace
+#endif // NDEBUG
+#endif // LOG_COMPILE_MIN_LEVEL
+
+// every logging thread own a bounded SPSC buffer of fixed size records, the logger thread drain all of them
+#ifndef LOG_RECORD_SIZE
+#define LOG_RECORD_SIZE 256
+#endif // LOG_RECORD_SIZE
+#ifndef LOG_THREAD_BUFFER_CAPACITY
+#define LOG_THREAD_BUFFER_CAPACITY 1024
+#endif // LOG_THREAD_BUFFER_CAPACITY
+// formatted lines are written to the sink in batches of this size
+#ifndef LOG_WRITE_BATCH_SIZE
+#define LOG_WRITE_BATCH_SIZE (64 * 1024)
+#endif // LOG_WRITE_BATCH_SIZE
 
 
 enum class ELogLevel : uint32_t
@@ -21,17 +63,82 @@ enum class ELogLevel : uint32_t
 	kLevelBitMask = kTrace | kDebug | kInfo | kWarning | kError | kFatal | kDisplay,
 };
 
+// default runtime level mask of logger and categories
+#ifndef LOG_DEFAULT_LEVEL_MASK
+#ifdef NDEBUG
+#define LOG_DEFAULT_LEVEL_MASK (uint32_t(ELogLevel::kLevelBitMask) & ~(uint32_t(ELogLevel::kTrace) | uint32_t(ELogLevel::kDebug)))
+#else
+#define LOG_DEFAULT_LEVEL_MASK uint32_t(ELogLevel::kLevelBitMask)
+#endif // NDEBUG
+#endif // LOG_DEFAULT_LEVEL_MASK
+
+// disable warning 4251
+#pragma warning(push)
+#pragma warning (disable: 4251)
+
+// named group of log call sites with a runtime level mask, define with DEFINE_LOG_CATEGORY
+// the mask is checked before the arguments are evaluated
+class CORE_API FLogCategory
+{
+public:
+	FLogCategory(const char* Name, uint32_t LevelMask = LOG_DEFAULT_LEVEL_MASK);
+	~FLogCategory();
+
+	bool IsEnabled(ELogLevel LogLevel) const { return (LevelMask.load(std::memory_order_relaxed) & uint32_t(LogLevel)) != 0; }
+
+	void SetLevelMask(uint32_t InLevelMask) { LevelMask.store(InLevelMask, std::memory_order_relaxed); }
+	uint32_t GetLevelMask() const { return LevelMask.load(std::memory_order_relaxed); }
+	const char* GetName() const { return Name; }
+
+	static FLogCategory* Find(std::string_view Name);
+	// return false when no category has this name
+	static bool SetLevelMask(std::string_view Name, uint32_t InLevelMask);
+
+private:
+	const char* Name;
+	std::atomic<uint32_t> LevelMask;
+
+	FLogCategory(const FLogCategory&) = delete;
+	FLogCategory& operator=(const FLogCategory&) = delete;
+};
+
+#pragma warning(pop)
+
+#define DECLARE_LOG_CATEGORY(Api, Category) extern Api FLogCategory Category;
+#define DEFINE_LOG_CATEGORY(Category, ...) FLogCategory Category(#Category, ##__VA_ARGS__);
+
+DECLARE_LOG_CATEGORY(CORE_API, LogNetwork)
+DECLARE_LOG_CATEGORY(CORE_API, LogReflect)
+
+// wall clock time in nanoseconds read from the steady clock
+// the offset to the system clock is calibrated on first use, timestamps stay ordered until the next Calibrate
+class CORE_API FLogClock
+{
+public:
+	static int64_t Now()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() +
+			GetOffset().load(std::memory_order_relaxed);
+	}
+
+	// resynchronize with the system clock, for long running processes
+	static void Calibrate();
+
+private:
+	static std::atomic<int64_t>& GetOffset();
+};
+
 struct FLogMessage
 {
 	FLogMessage() = default;
-	FLogMessage(time_t Timestamp, std::thread::id ThreadId, ELogLevel LogLevel, const std::string& Message)
+	FLogMessage(int64_t Timestamp, std::thread::id ThreadId, ELogLevel LogLevel, const std::string& Message)
 		: Timestamp(Timestamp)
 		, ThreadId(ThreadId)
 		, LogLevel(LogLevel)
 		, Message(Message)
 	{
 	}
-	FLogMessage(time_t Timestamp, std::thread::id ThreadId, ELogLevel LogLevel, std::string&& Message)
+	FLogMessage(int64_t Timestamp, std::thread::id ThreadId, ELogLevel LogLevel, std::string&& Message)
 		: Timestamp(Timestamp)
 		, ThreadId(ThreadId)
 		, LogLevel(LogLevel)
@@ -65,12 +172,130 @@ struct FLogMessage
 		return *this;
 	}
 
-	time_t Timestamp;
+	// nanoseconds since epoch, see FLogClock
+	int64_t Timestamp;
 	std::thread::id ThreadId;
 	ELogLevel LogLevel;
 	std::string Message;
 };
 
+// static descriptor of a deferred format call site, see CLogger::LogDeferred
+struct FLogFormat
+{
+	const char* Format;
+	// decode the packed arguments and append the formatted message
+	void(*FormatArguments)(std::string& Out, const char* Format, const char* Arguments);
+	// allocated in registration order
+	uint32_t Id;
+};
+
+CORE_API uint32_t AllocateLogFormatId();
+
+// string like arguments are packed as size + characters, other arguments must be trivially copyable
+template<typename T>
+constexpr bool IsLogStringArgument = std::is_convertible_v<const T&, std::string_view>;
+
+template<typename T>
+constexpr bool IsDeferrableLogArgument = IsLogStringArgument<T> || std::is_trivially_copyable_v<T>;
+
+template<typename T>
+using TUnpackedLogArgument = std::conditional_t<IsLogStringArgument<T>, std::string_view, T>;
+
+template<typename T>
+bool PackLogArgument(char*& Cursor, const char* End, const T& Argument)
+{
+	if constexpr (IsLogStringArgument<T>)
+	{
+		std::string_view String(Argument);
+		uint32_t Size = uint32_t(String.size());
+		if (size_t(End - Cursor) < sizeof(Size) + Size)
+			return false;
+		memcpy(Cursor, &Size, sizeof(Size));
+		memcpy(Cursor + sizeof(Size), String.data(), Size);
+		Cursor += sizeof(Size) + Size;
+	}
+	else
+	{
+		if (size_t(End - Cursor) < sizeof(T))
+			return false;
+		memcpy(Cursor, &Argument, sizeof(T));
+		Cursor += sizeof(T);
+	}
+	return true;
+}
+
+template<typename T>
+TUnpackedLogArgument<T> UnpackLogArgument(const char*& Cursor)
+{
+	if constexpr (IsLogStringArgument<T>)
+	{
+		uint32_t Size;
+		memcpy(&Size, Cursor, sizeof(Size));
+		std::string_view String(Cursor + sizeof(Size), Size);
+		Cursor += sizeof(Size) + Size;
+		return String;
+	}
+	else
+	{
+		T Argument;
+		memcpy(&Argument, Cursor, sizeof(T));
+		Cursor += sizeof(T);
+		return Argument;
+	}
+}
+
+template<typename ... TArgs>
+void FormatLogArguments(std::string& Out, const char* Format, [[maybe_unused]] const char* Arguments)
+{
+	// braced initialization unpack the arguments from left to right
+	std::tuple<TUnpackedLogArgument<TArgs>...> UnpackedArguments{ UnpackLogArgument<TArgs>(Arguments)... };
+	std::apply([&](auto& ... Args) {
+		std::vformat_to(std::back_inserter(Out), Format, std::make_format_args(Args...));
+		}, UnpackedArguments);
+}
+
+struct FLogRecordHeader
+{
+	// nanoseconds since epoch, see FLogClock
+	int64_t Timestamp;
+	std::thread::id ThreadId;
+	ELogLevel LogLevel;
+	uint32_t MessageSize;
+	// message longer than the inline payload, owned by the record until the logger thread consume it
+	std::string* LongMessage;
+	// not null when the payload hold packed arguments of a deferred format
+	const FLogFormat* Format;
+};
+
+struct FLogRecord : public FLogRecordHeader
+{
+	std::string_view GetMessage() const { return LongMessage ? std::string_view(*LongMessage) : std::string_view(Message, MessageSize); }
+
+	char Message[LOG_RECORD_SIZE - sizeof(FLogRecordHeader)];
+};
+
+// output of the logger, every method is called on the logger thread
+class CORE_API ILogSink
+{
+public:
+	virtual ~ILogSink() = default;
+	// Message is the formatted message without the trailing line ending
+	virtual void Write(const FLogRecordHeader& Record, std::string_view Message) = 0;
+	// called after every drained batch of records
+	virtual void Flush() {}
+};
+
+struct FLogThreadBuffer
+{
+	FLogThreadBuffer()
+		: Records(LOG_THREAD_BUFFER_CAPACITY)
+	{
+	}
+	TRingQueue<FLogRecord, EQueueMode::SPSC> Records;
+	// set when the logging thread exit, the logger thread release the buffer after drain it
+	std::atomic<bool> Closed{ false };
+};
+
 namespace std{
 	template<>
 	struct hash<FLogMessage> {
@@ -96,6 +321,19 @@ namespace std{
 		}
 	};
 }
+// suppression stage of the logger thread
+struct FLogSuppressionConfig
+{
+	// identical messages (same thread, level and text, see std::equal_to<FLogMessage>) inside the window
+	// are printed once then summarized as "repeated N times", 0 disable
+	// deferred logs (LOG_DEFERRED, LOG_CATEGORY) are identical when they come from the same call site,
+	// their summary show the format string
+	uint32_t DedupWindowMilliseconds{ 0 };
+	// token bucket per deferred format call site, other logs share one bucket, 0 disable
+	uint32_t RateLimitPerSecond{ 0 };
+	uint32_t RateLimitBurst{ 100 };
+};
+
 // disable warning 4251
 #pragma warning(push)
 #pragma warning (disable: 4251)
@@ -113,9 +351,47 @@ public:
 	template<typename ... TArgs>
 	void Log(ELogLevel LogLevel, const std::string_view Message, TArgs&& ... Args)
 	{
+		if (!IsEnabled(LogLevel))
+			return;
 		Log(LogLevel, std::format(Message, std::forward<TArgs>(Args)...));
 	}
 
+	// logger wide mask, checked after the category mask
+	bool IsEnabled(ELogLevel LogLevel) const { return (LevelMask.load(std::memory_order_relaxed) & uint32_t(LogLevel)) != 0; }
+	void SetLevelMask(uint32_t InLevelMask) { LevelMask.store(InLevelMask, std::memory_order_relaxed); }
+	uint32_t GetLevelMask() const { return LevelMask.load(std::memory_order_relaxed); }
+
+	// store the call site format and the raw arguments, the message is formatted on the logger thread
+	// TFormat is a captureless lambda returning the format string literal, see LOG_DEFERRED
+	template<typename TFormat, typename ... TArgs>
+	void LogDeferred(ELogLevel LogLevel, TFormat, const TArgs& ... Args)
+	{
+		if (!IsEnabled(LogLevel))
+			return;
+		if constexpr (!(IsDeferrableLogArgument<TArgs> && ...))
+		{
+			Log(LogLevel, std::vformat(TFormat{}(), std::make_format_args(Args...)));
+		}
+		else
+		{
+			// one descriptor per call site
+			static const FLogFormat LogFormat{ TFormat{}(), &FormatLogArguments<TArgs...>, AllocateLogFormatId() };
+			FLogRecord Record;
+			InitializeRecord(Record, LogLevel);
+			char* Cursor = Record.Message;
+			if ((PackLogArgument(Cursor, Record.Message + sizeof(Record.Message), Args) && ...))
+			{
+				Record.MessageSize = uint32_t(Cursor - Record.Message);
+				Record.Format = &LogFormat;
+				PushRecord(Record);
+			}
+			else
+			{
+				Log(LogLevel, std::vformat(LogFormat.Format, std::make_format_args(Args...)));
+			}
+		}
+	}
+
 	std::future<void> AddLogCallback(std::shared_ptr<std::function<void(const FLogMessage&)>> LogCallback)
 	{
 		std::shared_ptr<std::promise<void>> Promise = std::make_shared<std::promise<void>>();
@@ -124,6 +400,7 @@ public:
 			LogCallbacks.push_back(LogCallback);
 			Promise->set_value();
 		});
+		WakeUp();
 		return Future;
 	}
 
@@ -142,9 +419,55 @@ public:
 			}
 			Promise->set_value(false);
 		});
+		WakeUp();
+		return Future;
+	}
+
+	std::future<void> AddLogSink(std::shared_ptr<ILogSink> LogSink)
+	{
+		std::shared_ptr<std::promise<void>> Promise = std::make_shared<std::promise<void>>();
+		std::future<void> Future = Promise->get_future();
+		TaskQueue.Enqueue([&, LogSink, Promise] {
+			LogSinks.push_back(LogSink);
+			Promise->set_value();
+		});
+		WakeUp();
 		return Future;
 	}
 
+	// the sink is flushed before it is removed
+	std::future<bool> RemoveLogSink(std::shared_ptr<ILogSink> LogSink)
+	{
+		std::shared_ptr<std::promise<bool>> Promise = std::make_shared<std::promise<bool>>();
+		std::future<bool> Future = Promise->get_future();
+		TaskQueue.Enqueue([&, LogSink, Promise]() {
+			auto it = std::find(LogSinks.begin(), LogSinks.end(), LogSink);
+			if (it == LogSinks.end())
+			{
+				Promise->set_value(false);
+				return;
+			}
+			(*it)->Flush();
+			LogSinks.erase(it);
+			Promise->set_value(true);
+		});
+		WakeUp();
+		return Future;
+	}
+
+	void SetSuppressionConfig(const FLogSuppressionConfig& InSuppressionConfig)
+	{
+		TaskQueue.Enqueue([this, InSuppressionConfig] {
+			// report what is pending under the previous config
+			SweepSuppressed(INT64_MAX);
+			SuppressionConfig = InSuppressionConfig;
+		});
+		WakeUp();
+	}
+
+	// text output to std::cout, enabled by default
+	void SetConsoleOutput(bool Enable) { ConsoleOutput.store(Enable, std::memory_order_relaxed); }
+
 	//void Log(ELogLevel LogLevel, const std::string_view Message);
 	//template<typename ... TArgs>
 	//void Log(ELogLevel LogLevel, std::string&& Message, TArgs&& ... Args)
@@ -153,18 +476,87 @@ public:
 	//}
 
 protected:
+	static void InitializeRecord(FLogRecord& Record, ELogLevel LogLevel);
+
+	void PushRecord(const FLogRecord& Record);
+
+	FLogThreadBuffer& GetThreadBuffer();
+
+	// wake the logger thread if it is waiting for records
+	void WakeUp();
+
 	void Run();
 
-	void Loop();
+	// return false when there was nothing to do
+	bool Loop();
+
+	void WaitForWork();
+
+	void WriteRecord(const FLogRecord& Record);
+
+	// console, sinks and callbacks
+	void OutputMessage(const FLogRecordHeader& Record, std::string_view Message);
+
+	// return true when the message is dropped by the dedup window or the rate limit
+	bool Suppress(const FLogRecordHeader& Record, std::string_view Message);
+
+	// output the summaries of expired repeats and rate limit drops
+	void SweepSuppressed(int64_t Now);
+
+	void FlushWriteBatch();
 
 	std::atomic<bool> Running;
+	std::atomic<uint32_t> LevelMask{ LOG_DEFAULT_LEVEL_MASK };
 	std::thread LogThread;
+	// key of the thread local buffers, unique for every logger instance
+	const uint64_t LoggerId;
 
 	std::vector<std::shared_ptr<std::function<void(const FLogMessage&)>>> LogCallbacks;
+	std::vector<std::shared_ptr<ILogSink>> LogSinks;
+	std::atomic<bool> ConsoleOutput{ true };
 
 	TQueue<std::function<void()>, EQueueMode::MPSC> TaskQueue;
-	TQueue<FLogMessage, EQueueMode::MPSC> LogMessageQueue;
 
+	std::mutex ThreadBuffersMutex;
+	std::vector<std::shared_ptr<FLogThreadBuffer>> ThreadBuffers;
+	std::atomic<uint64_t> ThreadBuffersVersion{ 0 };
+
+	std::mutex WakeUpMutex;
+	std::condition_variable WakeUpCondition;
+	std::atomic<bool> Sleeping{ false };
+
+	// owned by the logger thread
+	std::vector<std::shared_ptr<FLogThreadBuffer>> DrainThreadBuffers;
+	uint64_t DrainThreadBuffersVersion{ 0 };
+	std::unique_ptr<FLogRecord[]> DrainRecords;
+	std::string DeferredMessage;
+	struct FLogRepeat
+	{
+		int64_t FirstTimestamp;
+		int64_t LastTimestamp;
+		uint32_t Count;
+	};
+
+	struct FLogRateLimit
+	{
+		double Tokens;
+		int64_t LastRefill;
+		int64_t LastReport;
+		uint64_t Dropped;
+	};
+
+	FLogSuppressionConfig SuppressionConfig;
+	std::unordered_map<FLogMessage, FLogRepeat> RepeatedMessages;
+	std::unordered_map<const FLogFormat*, FLogRateLimit> RateLimits;
+	// reused for lookups, keep the message capacity
+	FLogMessage SuppressionKey;
+	int64_t LastSuppressionSweep{ 0 };
+	// records logged by the logger thread itself and dropped because its buffer was full
+	uint64_t LoggerThreadDroppedRecords{ 0 };
+	// date and time of CachedTimeSecond, formatted once per second
+	int64_t CachedTimeSecond{ -1 };
+	std::string CachedTime;
+	std::string WriteBatch;
 };
 
 // disable warning 4251
@@ -178,8 +570,16 @@ CLogger* GLogInitializer();
 
 #define LOG(X, ...) GLogger->Log(ELogLevel::kDisplay, X, ##__VA_ARGS__)
 
-struct CLogScopeTimeConsume
-{
-
+// Format must be a string literal, arguments are formatted on the logger thread
+#define LOG_DEFERRED(Level, Format, ...) GLogger->LogDeferred(Level, [] { return Format; }, ##__VA_ARGS__)
 
-};
\ No newline at end of file
+// Level must be a constant ELogLevel, arguments are not evaluated when the level is disabled
+#define LOG_CATEGORY(Category, Level, Format, ...) \
+	do \
+	{ \
+		if constexpr (uint32_t(Level) >= uint32_t(LOG_COMPILE_MIN_LEVEL)) \
+		{ \
+			if ((Category).IsEnabled(Level)) \
+				LOG_DEFERRED(Level, Format, ##__VA_ARGS__); \
+		} \
+	} while (0)
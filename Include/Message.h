@@ -4,6 +4,8 @@
 #include <string>
 #include <memory>
 #include <cassert>
+#include <cstring>
+#include "MessageBufferPool.h"
 
 class SConnection;
 
@@ -24,98 +26,181 @@ struct FMessageData
 	};
 public:
 
-	FMessageData(const std::vector<uint8_t>& Body = {})
-		:Data(sizeof(FHeader), 0)
+	FMessageData() = default;
+
+	FMessageData(const std::vector<uint8_t>& Body)
 	{
 		SetBody(Body);
 	};
 
 	FMessageData(const std::string& Text)
-		:Data(sizeof(FHeader), 0)
 	{
 		SetBody(Text);
 	};
 
-	FMessageData(const FMessageData&) = default;
-	FMessageData(FMessageData&& Other)
+	FMessageData(const FMessageData& Other)
+	{
+		CopyFrom(Other);
+	}
+
+	// leave Other empty without allocating, the header is allocated again on first use
+	FMessageData(FMessageData&& Other) noexcept
+		: Data(Other.Data)
+		, Size(Other.Size)
+		, Capacity(Other.Capacity)
+	{
+		Other.Data = nullptr;
+		Other.Size = 0;
+		Other.Capacity = 0;
+	}
+
+	~FMessageData()
+	{
+		FMessageBufferPool::Get().Release(Data);
+	}
+
+	FMessageData& operator=(const FMessageData& Other)
 	{
-		this->Data = std::move(Other.Data);
-		Other.SetBody(std::vector<uint8_t>());
+		if (std::addressof(Other) != this)
+			CopyFrom(Other);
+		return *this;
 	}
 
-	FMessageData& operator=(const FMessageData&) = default;
-	FMessageData& operator=(FMessageData&& Other)
+	FMessageData& operator=(FMessageData&& Other) noexcept
 	{
 		assert(std::addressof(Other) != this);
-		this->Data = std::move(Other.Data);
-		Other.SetBody(std::vector<uint8_t>());
+		FMessageBufferPool::Get().Release(Data);
+		Data = Other.Data;
+		Size = Other.Size;
+		Capacity = Other.Capacity;
+		Other.Data = nullptr;
+		Other.Size = 0;
+		Other.Capacity = 0;
 		return *this;
 	}
 
-	uint32_t GetBodySize() { return reinterpret_cast<FHeader*>(Data.data())->BodySize; }
+	uint32_t GetBodySize() { return GetHeader()->BodySize; }
 	void SetBodySize(uint32_t NewBodySize)
 	{
-		Data.resize(sizeof(FHeader) + NewBodySize);
-		reinterpret_cast<FHeader*>(Data.data())->BodySize = NewBodySize;
+		Resize(sizeof(FHeader) + NewBodySize);
+		GetHeader()->BodySize = NewBodySize;
 	}
 
-	uint32_t GetDataDesc() { return reinterpret_cast<FHeader*>(Data.data())->DataDesc; }
+	uint32_t GetDataDesc() { return GetHeader()->DataDesc; }
 	void SetDataDesc(uint32_t NewDataDesc)
 	{
-		reinterpret_cast<FHeader*>(Data.data())->DataDesc = NewDataDesc;
+		GetHeader()->DataDesc = NewDataDesc;
 	}
 
-	uint64_t GetSequenceNumber() { return reinterpret_cast<FHeader*>(Data.data())->SequenceNumber; }
+	uint64_t GetSequenceNumber() { return GetHeader()->SequenceNumber; }
 	void SetSequenceNumber(uint64_t NewSequenceNumber)
 	{
-		reinterpret_cast<FHeader*>(Data.data())->SequenceNumber = NewSequenceNumber;
+		GetHeader()->SequenceNumber = NewSequenceNumber;
 	}
 
 	constexpr uint32_t GetHeaderSize() { return sizeof(FHeader); }
 
-	FHeader* GetHeader() { return reinterpret_cast<FHeader*>(Data.data()); }
+	FHeader* GetHeader()
+	{
+		if (Data == nullptr) Resize(sizeof(FHeader));
+		return reinterpret_cast<FHeader*>(Data);
+	}
 
-	uint32_t GetBodyBufferSize() { return static_cast<uint32_t>(Data.size() - sizeof(FHeader)); }
+	uint32_t GetBodyBufferSize() { return GetSize() - sizeof(FHeader); }
 
 	template<typename T>
-	T* GetBody() { return reinterpret_cast<T*>(Data.data() + sizeof(FHeader)); }
+	T* GetBody() { return reinterpret_cast<T*>(reinterpret_cast<uint8_t*>(GetHeader()) + sizeof(FHeader)); }
 
 	void SetBody(const std::vector<uint8_t>& NewBody) {
-		Data.resize(sizeof(FHeader) + NewBody.size());
+		SetBodySize(static_cast<uint32_t>(NewBody.size()));
 		memcpy(GetBody<void>(), NewBody.data(), NewBody.size());
-		SetBodySize(static_cast<int32_t>(NewBody.size()));
 		return;
 	}
 
 	void SetBody(const std::string& NewBody) {
-		Data.resize(sizeof(FHeader) + NewBody.size());
+		SetBodySize(static_cast<uint32_t>(NewBody.size()));
 		memcpy(GetBody<void>(), NewBody.data(), NewBody.size());
-		SetBodySize(static_cast<int32_t>(NewBody.size()));
 		return;
 	}
 
 	template<typename T>
 	void SetBody(T& NewBody) {
-		Data.resize(sizeof(FHeader) + sizeof(T));
-		memcpy(GetBody<void>(), &NewBody, sizeof(T));
 		SetBodySize(sizeof(T));
+		memcpy(GetBody<void>(), &NewBody, sizeof(T));
 	}
 
-	std::vector<uint8_t> FullData() { return Data; }
+	// copy a received frame, header included
+	void SetFullData(const uint8_t* Frame, uint32_t FrameSize)
+	{
+		assert(FrameSize >= sizeof(FHeader));
+		Size = 0;
+		ReserveSize(FrameSize);
+		Size = FrameSize;
+		memcpy(Data, Frame, FrameSize);
+	}
+
+	std::vector<uint8_t> FullData()
+	{
+		GetHeader();
+		return std::vector<uint8_t>(Data, Data + Size);
+	}
 	void UpdateBodySize()
 	{
-		Data.resize(sizeof(FHeader) + GetBodySize());
+		Resize(sizeof(FHeader) + GetBodySize());
 	}
 
-	int32_t GetSize() { return (int32_t)Data.size(); }
+	int32_t GetSize() { GetHeader(); return (int32_t)Size; }
 
 private:
 	void ReserveSize(uint32_t NewReserveSize)
 	{
-		Data.reserve(NewReserveSize);
+		if (NewReserveSize > Capacity)
+			Grow(NewReserveSize);
+	}
+
+	// keep the old content, the grown bytes are zeroed
+	void Resize(uint32_t NewSize)
+	{
+		if (NewSize > Capacity)
+			Grow(NewSize);
+		if (NewSize > Size)
+			memset(Data + Size, 0, NewSize - Size);
+		Size = NewSize;
+	}
+
+	// keep the old content, zero the header of a new buffer
+	void Grow(uint32_t NewReserveSize)
+	{
+		uint32_t NewCapacity = 0;
+		uint8_t* NewData = FMessageBufferPool::Get().Acquire(NewReserveSize, NewCapacity);
+		if (Data != nullptr)
+			memcpy(NewData, Data, Size);
+		else
+			memset(NewData, 0, sizeof(FHeader));
+		FMessageBufferPool::Get().Release(Data);
+		Data = NewData;
+		Capacity = NewCapacity;
+	}
+
+	void CopyFrom(const FMessageData& Other)
+	{
+		Size = 0;
+		if (Other.Data == nullptr)
+		{
+			FMessageBufferPool::Get().Release(Data);
+			Data = nullptr;
+			Capacity = 0;
+			return;
+		}
+		ReserveSize(Other.Size);
+		Size = Other.Size;
+		memcpy(Data, Other.Data, Other.Size);
 	}
 
-	std::vector<uint8_t> Data;
+	// buffer from FMessageBufferPool, header followed by body
+	uint8_t* Data{ nullptr };
+	uint32_t Size{ 0 };
+	uint32_t Capacity{ 0 };
 };
 
 struct FMessage {
@@ -0,0 +1,63 @@
+#pragma once
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include "CoreApi.h"
+#include "RingQueue.h"
+
+// disable warning 4251
+#pragma warning(push)
+#pragma warning (disable: 4251)
+
+// size classed buffer pool for FMessageData
+// blocks are carved from slabs and recycled through a lock-free free list per size class,
+// requests bigger than the largest class and blocks over a class budget fall back to new/delete
+class CORE_API FMessageBufferPool
+{
+public:
+	static constexpr uint32_t kNumSizeClasses = 5;
+	static constexpr uint32_t kSizeClasses[kNumSizeClasses] = { 64, 256, 1024, 4096, 65536 };
+	// max number of blocks a size class keeps, about 1MB for the small classes
+	static constexpr uint32_t kMaxBlocks[kNumSizeClasses] = { 16384, 4096, 1024, 256, 64 };
+	static constexpr uint32_t kBlocksPerSlab[kNumSizeClasses] = { 256, 64, 16, 4, 1 };
+	static constexpr uint32_t kHeapSizeClass = UINT32_MAX;
+
+	static FMessageBufferPool& Get();
+
+	// return a block with at least Size bytes, OutCapacity receive the usable size of the block
+	uint8_t* Acquire(uint32_t Size, uint32_t& OutCapacity);
+	void Release(uint8_t* Data);
+
+	uint64_t GetHeapAllocationCounter() const { return HeapAllocationCounter.load(std::memory_order_relaxed); }
+
+private:
+	FMessageBufferPool();
+	~FMessageBufferPool();
+
+	// prefix of every block, keep 16 bytes so the data stay aligned for FMessageData::FHeader
+	struct alignas(16) FBlockHeader
+	{
+		uint32_t SizeClass;
+		uint32_t Capacity;
+	};
+
+	struct FSizeClass
+	{
+		FSizeClass(uint32_t MaxBlocks)
+			: FreeBlocks(MaxBlocks)
+		{
+		}
+		TRingQueue<uint8_t*, EQueueMode::MPMC> FreeBlocks;
+		std::mutex SlabMutex;
+		std::vector<std::unique_ptr<uint8_t[]>> Slabs;
+		uint32_t NumBlocks{ 0 };
+	};
+
+	uint8_t* AllocateFromSlab(uint32_t SizeClass);
+
+	std::unique_ptr<FSizeClass> SizeClasses[kNumSizeClasses];
+	std::atomic<uint64_t> HeapAllocationCounter{ 0 };
+};
+
+#pragma warning(pop)
@@ -0,0 +1,266 @@
+#pragma once
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include <string_view>
+#include <type_traits>
+
+#ifdef CORE_MODULE
+#include "CoreApi.h"
+#elif !defined(CORE_API)
+#define CORE_API
+#endif
+
+// FNV-1a 64, 0 is kept for the empty slots of TNameMap
+constexpr uint64_t HashName(std::string_view Name)
+{
+	uint64_t Hash = 14695981039346656037ull;
+	for (char Character : Name)
+		Hash = (Hash ^ uint8_t(Character)) * 1099511628211ull;
+	return Hash ? Hash : 1;
+}
+
+// name with its hash, a constexpr key hash the name at compile time
+// static constexpr FNameKey PlayerKey("FPlayer"); GMetaTable->GetMeta(PlayerKey);
+struct FNameKey
+{
+	constexpr explicit FNameKey(std::string_view InName)
+		: Name(InName)
+		, Hash(HashName(InName))
+	{
+	}
+
+	std::string_view Name;
+	uint64_t Hash;
+};
+
+template<typename TValue, bool InternKeys>
+class TNameMap;
+
+// disable warning 4251
+#pragma warning(push)
+#pragma warning (disable: 4251)
+
+// the characters of every interned name are stored once and never freed, so the returned views stay valid
+class CORE_API FNameTable
+{
+public:
+	static FNameTable& Get();
+
+	// thread safe
+	std::string_view Intern(std::string_view Name);
+
+private:
+	FNameTable();
+	~FNameTable();
+
+	std::mutex Mutex;
+	// keys point into the blocks
+	std::unique_ptr<TNameMap<uint32_t, false>> Names;
+	std::vector<std::unique_ptr<char[]>> Blocks;
+	size_t BlockUsed{ 0 };
+	size_t BlockSize{ 0 };
+};
+
+#pragma warning(pop)
+
+// open addressing map of names, linear probing over a contiguous array of precomputed hashes
+// a lookup compare the 8 bytes hashes of neighbour slots and the name only when the hash match,
+// the map is at most half full so most lookups read one cache line of hashes
+// keys are interned by FNameTable unless InternKeys is false, names can't be removed
+// std::unordered_map style members are kept for the code written against the previous maps
+template<typename TValue, bool InternKeys = true>
+class TNameMap
+{
+public:
+	using FEntry = std::pair<std::string_view, TValue>;
+
+	template<bool IsConst>
+	class TIterator
+	{
+		using FMap = std::conditional_t<IsConst, const TNameMap, TNameMap>;
+		using FReference = std::conditional_t<IsConst, const FEntry&, FEntry&>;
+		using FPointer = std::conditional_t<IsConst, const FEntry*, FEntry*>;
+	public:
+		TIterator(FMap* InMap, size_t InIndex)
+			: Map(InMap)
+			, Index(InIndex)
+		{
+			SkipEmpty();
+		}
+
+		FReference operator*() const { return Map->Entries[Index]; }
+		FPointer operator->() const { return &Map->Entries[Index]; }
+		TIterator& operator++() { Index++; SkipEmpty(); return *this; }
+		bool operator==(const TIterator& Other) const { return Index == Other.Index; }
+		bool operator!=(const TIterator& Other) const { return Index != Other.Index; }
+
+	private:
+		void SkipEmpty()
+		{
+			while (Index < Map->Capacity && Map->Hashes[Index] == 0)
+				Index++;
+		}
+
+		FMap* Map;
+		size_t Index;
+	};
+
+	using iterator = TIterator<false>;
+	using const_iterator = TIterator<true>;
+
+	TNameMap() = default;
+	TNameMap(const TNameMap&) = delete;
+	TNameMap& operator=(const TNameMap&) = delete;
+
+	TValue* Find(const FNameKey& Key)
+	{
+		size_t Index = FindIndex(Key);
+		return Index == Capacity ? nullptr : &Entries[Index].second;
+	}
+
+	const TValue* Find(const FNameKey& Key) const { return const_cast<TNameMap*>(this)->Find(Key); }
+
+	TValue* Find(std::string_view Name) { return Find(FNameKey(Name)); }
+	const TValue* Find(std::string_view Name) const { return Find(FNameKey(Name)); }
+
+	// return false and keep the old value when the name is already in the map
+	bool Insert(std::string_view Name, TValue Value)
+	{
+		bool IsNew;
+		TValue& Slot = FindOrAdd(FNameKey(Name), IsNew);
+		if (IsNew)
+			Slot = std::move(Value);
+		return IsNew;
+	}
+
+	TValue& FindOrAdd(const FNameKey& Key, bool& OutIsNew)
+	{
+		return Entries[FindOrAddIndex(Key, OutIsNew)].second;
+	}
+
+	size_t Num() const { return Size; }
+
+	void Reserve(size_t Number)
+	{
+		size_t NewCapacity = Capacity ? Capacity : 8;
+		while (NewCapacity < Number * 2)
+			NewCapacity *= 2;
+		if (NewCapacity > Capacity)
+			Rehash(NewCapacity);
+	}
+
+	void Empty()
+	{
+		Hashes.reset();
+		Entries.reset();
+		Capacity = 0;
+		Size = 0;
+	}
+
+	iterator begin() { return iterator(this, 0); }
+	iterator end() { return iterator(this, Capacity); }
+	const_iterator begin() const { return const_iterator(this, 0); }
+	const_iterator end() const { return const_iterator(this, Capacity); }
+
+	iterator find(std::string_view Name) { return iterator(this, FindIndex(FNameKey(Name))); }
+	const_iterator find(std::string_view Name) const { return const_iterator(this, FindIndex(FNameKey(Name))); }
+	size_t size() const { return Size; }
+	bool empty() const { return Size == 0; }
+	size_t count(std::string_view Name) const { return Find(Name) ? 1 : 0; }
+
+	std::pair<iterator, bool> insert(const FEntry& Entry) { return emplace(Entry.first, Entry.second); }
+
+	template<typename TKey, typename TOtherValue>
+	std::pair<iterator, bool> insert(const std::pair<TKey, TOtherValue>& Entry) { return emplace(Entry.first, Entry.second); }
+
+	template<typename TOtherValue>
+	std::pair<iterator, bool> emplace(std::string_view Name, TOtherValue&& Value)
+	{
+		bool IsNew;
+		size_t Index = FindOrAddIndex(FNameKey(Name), IsNew);
+		if (IsNew)
+			Entries[Index].second = TValue(std::forward<TOtherValue>(Value));
+		return std::make_pair(iterator(this, Index), IsNew);
+	}
+
+	TValue& operator[](std::string_view Name)
+	{
+		bool IsNew;
+		return FindOrAdd(FNameKey(Name), IsNew);
+	}
+
+private:
+	static size_t GetHomeIndex(uint64_t Hash, size_t Mask) { return size_t(Hash ^ (Hash >> 32)) & Mask; }
+
+	// Capacity when the name is not in the map
+	size_t FindIndex(const FNameKey& Key) const
+	{
+		if (Size == 0)
+			return Capacity;
+		size_t Mask = Capacity - 1;
+		for (size_t Index = GetHomeIndex(Key.Hash, Mask);; Index = (Index + 1) & Mask)
+		{
+			if (Hashes[Index] == 0)
+				return Capacity;
+			if (Hashes[Index] == Key.Hash && Entries[Index].first == Key.Name)
+				return Index;
+		}
+	}
+
+	size_t FindOrAddIndex(const FNameKey& Key, bool& OutIsNew)
+	{
+		if ((Size + 1) * 2 > Capacity)
+			Rehash(Capacity ? Capacity * 2 : 8);
+		size_t Mask = Capacity - 1;
+		for (size_t Index = GetHomeIndex(Key.Hash, Mask);; Index = (Index + 1) & Mask)
+		{
+			if (Hashes[Index] == 0)
+			{
+				Hashes[Index] = Key.Hash;
+				if constexpr (InternKeys)
+					Entries[Index].first = FNameTable::Get().Intern(Key.Name);
+				else
+					Entries[Index].first = Key.Name;
+				Size++;
+				OutIsNew = true;
+				return Index;
+			}
+			if (Hashes[Index] == Key.Hash && Entries[Index].first == Key.Name)
+			{
+				OutIsNew = false;
+				return Index;
+			}
+		}
+	}
+
+	void Rehash(size_t NewCapacity)
+	{
+		assert((NewCapacity & (NewCapacity - 1)) == 0);
+		std::unique_ptr<uint64_t[]> OldHashes = std::move(Hashes);
+		std::unique_ptr<FEntry[]> OldEntries = std::move(Entries);
+		size_t OldCapacity = Capacity;
+		Hashes = std::make_unique<uint64_t[]>(NewCapacity);
+		Entries = std::make_unique<FEntry[]>(NewCapacity);
+		Capacity = NewCapacity;
+		size_t Mask = Capacity - 1;
+		for (size_t i = 0; i < OldCapacity; i++)
+		{
+			if (OldHashes[i] == 0)
+				continue;
+			size_t Index = GetHomeIndex(OldHashes[i], Mask);
+			while (Hashes[Index] != 0)
+				Index = (Index + 1) & Mask;
+			Hashes[Index] = OldHashes[i];
+			Entries[Index] = std::move(OldEntries[i]);
+		}
+	}
+
+	std::unique_ptr<uint64_t[]> Hashes;
+	std::unique_ptr<FEntry[]> Entries;
+	size_t Capacity{ 0 };
+	size_t Size{ 0 };
+};
@@ -1,5 +1,7 @@
 #pragma once
 #include <memory>
+#include <atomic>
+#include <cstdint>
 #include "PlatformImplement.h"
 
 namespace EQueueMode{
@@ -7,15 +9,31 @@ namespace EQueueMode{
 	{
 		SPSC,
 		MPSC,
+		// only supported by TRingQueue
+		MPMC,
 	};
 }
 
-template<typename T, EQueueMode::Type Mode = EQueueMode::SPSC>
+namespace EQueueNodeAllocator{
+	enum Type
+	{
+		// new/delete every node
+		Heap,
+		// recycle nodes through a lock-free free list owned by the queue
+		Pool,
+	};
+}
+
+#define QUEUE_DEFAULT_NODE_POOL_HIGH_WATER_MARK 4096
+
+template<typename T, EQueueMode::Type Mode = EQueueMode::SPSC, EQueueNodeAllocator::Type Allocator = EQueueNodeAllocator::Heap>
 class TQueue
 {
+	static_assert(Mode != EQueueMode::MPMC, "TQueue not support MPMC, use TRingQueue");
 public:
 
-	TQueue()
+	explicit TQueue(uint32_t InNodePoolHighWaterMark = QUEUE_DEFAULT_NODE_POOL_HIGH_WATER_MARK)
+		: NodePoolHighWaterMark(InNodePoolHighWaterMark)
 	{
 		Head = Tail = new TNode();
 	}
@@ -29,6 +47,16 @@ public:
 
 			delete Node;
 		}
+		if (Allocator == EQueueNodeAllocator::Pool)
+		{
+			TNode* Node = UnpackNode(FreeListHead.load(std::memory_order_acquire));
+			while (Node != nullptr)
+			{
+				TNode* NextNode = Node->NextNode;
+				delete Node;
+				Node = NextNode;
+			}
+		}
 	}
 
 	bool Dequeue(T& OutElement)
@@ -45,14 +73,14 @@ public:
 		TNode* OldTail = Tail;
 		Tail = Popped;
 		Tail->Element = T();
-		delete OldTail;
+		FreeNode(OldTail);
 
 		return true;
 	}
 
 	bool Enqueue(const T& Element)
 	{
-		TNode* NewNode = new TNode(Element);
+		TNode* NewNode = AllocateNode(Element);
 
 		if (NewNode == nullptr)
 		{
@@ -78,7 +106,7 @@ public:
 
 	bool Enqueue(T&& Element)
 	{
-		TNode* NewNode = new TNode(std::move(Element));
+		TNode* NewNode = AllocateNode(std::move(Element));
 
 		if (NewNode == nullptr)
 		{
@@ -152,7 +180,7 @@ public:
 		TNode* OldTail = Tail;
 		Tail = Popped;
 		Tail->Element = T();
-		delete OldTail;
+		FreeNode(OldTail);
 
 		return true;
 	}
@@ -168,6 +196,11 @@ public:
 		return false;
 	}
 
+	// max number of nodes the pool keeps alive (free and in flight), only used by EQueueNodeAllocator::Pool
+	void SetNodePoolHighWaterMark(uint32_t InNodePoolHighWaterMark) { NodePoolHighWaterMark = InNodePoolHighWaterMark; }
+	uint32_t GetNodePoolHighWaterMark() const { return NodePoolHighWaterMark; }
+	uint32_t GetPooledNodeCount() const { return PooledNodeCount.load(std::memory_order_relaxed); }
+
 private:
 
 	struct TNode
@@ -188,12 +221,84 @@ private:
 
 		alignas(8) TNode* NextNode;
 		T Element;
+		// node belongs to the pool, it is never deleted before the queue
+		bool IsPooled{ false };
 	};
 
+	// free list head is a node pointer packed with an ABA tag in the unused high bits
+	static constexpr uint32_t kTagShift = sizeof(void*) == 8 ? 48 : 32;
+	static constexpr uint64_t kPointerMask = (uint64_t(1) << kTagShift) - 1;
+
+	static TNode* UnpackNode(uint64_t Packed) { return reinterpret_cast<TNode*>(static_cast<uintptr_t>(Packed & kPointerMask)); }
+	static uint64_t PackNode(TNode* Node, uint64_t Tag) { return (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(Node)) & kPointerMask) | (Tag << kTagShift); }
+	static uint64_t NextTag(uint64_t Packed) { return (Packed >> kTagShift) + 1; }
+
+	// called by producers
+	TNode* PopFreeNode()
+	{
+		uint64_t OldHead = FreeListHead.load(std::memory_order_acquire);
+		while (TNode* Node = UnpackNode(OldHead))
+		{
+			// pooled nodes live as long as the queue, so a stale read here is harmless, the tag rejects it
+			uint64_t NewHead = PackNode(Node->NextNode, NextTag(OldHead));
+			if (FreeListHead.compare_exchange_weak(OldHead, NewHead, std::memory_order_acquire, std::memory_order_acquire))
+			{
+				Node->NextNode = nullptr;
+				return Node;
+			}
+		}
+		return nullptr;
+	}
+
+	// called by the consumer
+	void PushFreeNode(TNode* Node)
+	{
+		uint64_t OldHead = FreeListHead.load(std::memory_order_relaxed);
+		do {
+			Node->NextNode = UnpackNode(OldHead);
+		} while (!FreeListHead.compare_exchange_weak(OldHead, PackNode(Node, NextTag(OldHead)), std::memory_order_release, std::memory_order_relaxed));
+	}
+
+	template<typename TElement>
+	TNode* AllocateNode(TElement&& Element)
+	{
+		if (Allocator == EQueueNodeAllocator::Pool)
+		{
+			if (TNode* Node = PopFreeNode())
+			{
+				Node->Element = std::forward<TElement>(Element);
+				return Node;
+			}
+		}
+		return new TNode(std::forward<TElement>(Element));
+	}
+
+	void FreeNode(TNode* Node)
+	{
+		if (Allocator == EQueueNodeAllocator::Pool)
+		{
+			if (!Node->IsPooled && PooledNodeCount.load(std::memory_order_relaxed) < NodePoolHighWaterMark)
+			{
+				PooledNodeCount.fetch_add(1, std::memory_order_relaxed);
+				Node->IsPooled = true;
+			}
+			if (Node->IsPooled)
+			{
+				PushFreeNode(Node);
+				return;
+			}
+		}
+		delete Node;
+	}
+
 	alignas(8) TNode* Head;
 
 	alignas(8)TNode* Tail;
 
+	alignas(64) std::atomic<uint64_t> FreeListHead{ 0 };
+	std::atomic<uint32_t> PooledNodeCount{ 0 };
+	uint32_t NodePoolHighWaterMark;
+
 private:
 
 	TQueue(const TQueue&) = delete;
@@ -17,6 +17,7 @@
 #else
 #define CORE_API
 #endif
+#include "NameMap.h"
 
 #ifdef __REFLECTOR__
 #define CLASS(...)     __attribute__((annotate("Meta" __VA_OPT__(",") #__VA_ARGS__)))
@@ -64,6 +65,7 @@ typedef void  (*FPDestructor)(void* O);
 
 struct CClass;
 struct FProperty;
+struct FReflectSerializePlan;
 
 // [Begin, End)
 template<typename T>
@@ -172,7 +174,7 @@ public:
 	STRING_TYPE Name;
 	Uint32 Flag{ 0 };
 	std::vector<STRING_TYPE> Alias;
-	std::unordered_map<std::string, STRING_TYPE> Data;
+	TNameMap<STRING_TYPE> Data;
 
 	bool HasFlag(Uint32 InFlag)    { return Flag & InFlag; }
 	void AddFlag(Uint32 InFlag)    { Flag = Flag | InFlag; }
@@ -257,6 +259,9 @@ struct CORE_API FClass : public FMeta
 	FPDelete      Delete     { nullptr };
 	FPConstructor Constructor{ nullptr };
 	FPDestructor  Destructor { nullptr };
+
+	// compiled by FReflectSerializer on first use, owned by the serializer
+	mutable std::atomic<const FReflectSerializePlan*> SerializePlan{ nullptr };
 };
 
 struct CORE_API FEnum : public FMeta
@@ -285,7 +290,7 @@ struct CORE_API FEnum : public FMeta
 struct CORE_API FMetaTable {
 public:
 	FMetaTable();
-	std::unordered_map<std::string, Uint32> NameToId;
+	TNameMap<Uint32> NameToId;
 	std::vector<FMeta*> Metas;
 	std::atomic<Uint32> IdCounter{ 1 };
 	std::list<std::function<void()>> DeferredRegisterList;
@@ -293,7 +298,9 @@ public:
 
 	static FMetaTable& Get();
 
-	FMeta* GetMeta(const char* MetaName);
+	FMeta* GetMeta(std::string_view MetaName);
+	// MetaName can be a constexpr FNameKey, hashed at compile time
+	FMeta* GetMeta(const FNameKey& MetaName);
 	FMeta* GetMeta(Uint32 MetaId);
 	uint32_t RegisterMetaToTable(FMeta* Meta);
 
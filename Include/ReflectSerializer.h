@@ -0,0 +1,91 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <unordered_map>
+#include "CoreApi.h"
+#include "Reflect.h"
+#include "Message.h"
+
+// compact binary encoding of reflected objects, walk FClass::Properties (parent class first):
+// bool and 8 bit integers are one byte, other integers are varints (signed are zigzag), float and double are copied from memory (little endian hosts only),
+// string is a varint size followed by the characters, struct and class are their properties inline, enum is a signed varint,
+// a fixed array (Number > 1) is Number elements, EPF_ArrayFlag (std::vector of numeric or string) is a varint count followed by the elements
+// pointer and reference properties are not serialized, map properties fail the serialization
+// every class is compiled once into a flat plan of copy/varint/string ops, merging neighbour fields encoded as they are in memory
+//
+// a 4 bytes little endian hash of the class name, then for every field a 4 bytes little endian tag (hash of the property name, type and Number),
+// a varint payload size and the payload encoded as above, struct and class payloads are nested tagged objects without the class hash
+// unknown fields are skipped by their size and fields missing from the data keep their value
+struct FReflectPeerClass
+{
+	// field tags in the order the peer write them
+	std::vector<uint32_t> Tags;
+	// local field of every peer field, -1 when the field is unknown locally
+	std::vector<Int32> LocalFields;
+	bool Mapped{ false };
+};
+
+// disable warning 4251
+#pragma warning(push)
+#pragma warning (disable: 4251)
+
+// field order of the classes of one peer, received from its FReflectSerializer::SerializeSchema when the connection is established,
+// the tagged decoding of this peer map fields by position instead of looking up their tags
+// not thread safe, keep one per connection and use it from the thread decoding its messages
+class CORE_API FReflectPeerSchema
+{
+public:
+	// merge the schema sent by the peer, return false when the data is corrupt
+	bool AddSchema(const uint8_t* Data, size_t Size);
+	bool AddSchema(FMessageData& MessageData);
+
+	// null when the peer sent no schema of the class, the mapping to the local fields is built on the first call
+	const FReflectPeerClass* FindClass(const FClass* Class);
+
+	void Clear();
+
+private:
+	std::unordered_map<uint32_t, FReflectPeerClass> PeerClasses;
+};
+
+#pragma warning(pop)
+
+class CORE_API FReflectSerializer
+{
+public:
+	// compile the plan ahead of the first use, return false when the class can't be serialized
+	static bool CompilePlan(const FClass* Class);
+
+	// append the encoding of Object to Out
+	static bool Serialize(const FClass* Class, const void* Object, std::vector<uint8_t>& Out);
+
+	// replace the body of MessageData with the encoding of Object, the body is allocated once
+	static bool Serialize(const FClass* Class, const void* Object, FMessageData& MessageData);
+
+	// Object must be constructed, OutReadSize is the number of bytes decoded
+	static bool Deserialize(const FClass* Class, void* Object, const uint8_t* Data, size_t Size, size_t* OutReadSize = nullptr);
+
+	static bool Deserialize(const FClass* Class, void* Object, FMessageData& MessageData);
+
+	// append the tagged encoding of Object to Out
+	static bool SerializeTagged(const FClass* Class, const void* Object, std::vector<uint8_t>& Out);
+
+	static bool SerializeTagged(const FClass* Class, const void* Object, FMessageData& MessageData);
+
+	// PeerSchema is optional, it only speeds up the decoding
+	static bool DeserializeTagged(const FClass* Class, void* Object, const uint8_t* Data, size_t Size, FReflectPeerSchema* PeerSchema = nullptr);
+
+	static bool DeserializeTagged(const FClass* Class, void* Object, FMessageData& MessageData, FReflectPeerSchema* PeerSchema = nullptr);
+
+	// stable across builds, unlike FMeta::Id
+	static uint32_t GetClassHash(const FClass* Class);
+
+	// append the field tags of the class and of its nested classes, for FReflectPeerSchema::AddSchema of the peer
+	static bool SerializeSchema(const FClass* Class, std::vector<uint8_t>& Out);
+
+	template<typename T>
+	static bool Serialize(const T& Object, FMessageData& MessageData) { return Serialize(T::StaticClass(), &Object, MessageData); }
+
+	template<typename T>
+	static bool Deserialize(T& Object, FMessageData& MessageData) { return Deserialize(T::StaticClass(), &Object, MessageData); }
+};
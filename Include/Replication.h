@@ -0,0 +1,104 @@
+#pragma once
+#include <deque>
+#include <vector>
+#include <string>
+#include <cstdint>
+#include "CoreApi.h"
+#include "Reflect.h"
+#include "Message.h"
+
+class SConnection;
+
+// deltas waiting for an ack, past this the sender forget its acked state and send the whole object again
+#ifndef REPLICATION_MAX_PENDING_DELTAS
+#define REPLICATION_MAX_PENDING_DELTAS 64
+#endif // REPLICATION_MAX_PENDING_DELTAS
+
+struct FReplicationLayout;
+
+// value of a replicated field, integers, enums and the bits of floating points are in Bits
+struct FReplicationValue
+{
+	bool operator==(const FReplicationValue& Other) const { return Bits == Other.Bits && String == Other.String; }
+	bool operator!=(const FReplicationValue& Other) const { return !(*this == Other); }
+
+	uint64_t Bits{ 0 };
+	std::string String;
+};
+
+// disable warning 4251
+#pragma warning(push)
+#pragma warning (disable: 4251)
+
+// replicate one object to one connection, only the fields changed since the state acknowledged by the peer are sent
+// the fields are the bool, numeric, enum and string properties of FClass::Properties (parent class first),
+// nested structs and fixed arrays are flattened into their elements, std::vector, map, pointer and reference properties are not replicated
+// delta body: little endian uint32 layout hash, varint sequence, dirty bitmask of (field count + 7) / 8 bytes, then the value of every dirty field
+// not thread safe, use it from the thread sending to the connection
+class CORE_API FReplicationSender
+{
+public:
+	FReplicationSender(const FClass* Class, uint32_t DataDesc = 0);
+
+	// send the delta of Object, return the value of SConnection::Send, 0 when nothing changed or the send failed
+	uint64_t Replicate(SConnection* Connection, const void* Object);
+
+	// build the delta of Object without sending it, return false when nothing changed
+	bool BuildDelta(const void* Object, FMessageData& MessageData);
+
+	// the peer applied the delta Sequence, the next deltas are computed against it
+	void Acknowledge(uint32_t Sequence);
+
+	// ack message built by FReplicationReceiver::BuildAck
+	bool Acknowledge(FMessageData& MessageData);
+
+	// forget the acked state, the next delta send every field
+	void Reset();
+
+	size_t GetPendingDeltaCount() const { return PendingDeltas.size(); }
+
+private:
+	struct FPendingDelta
+	{
+		uint32_t Sequence;
+		std::vector<uint64_t> DirtyMask;
+		std::vector<FReplicationValue> Snapshot;
+	};
+
+	const FReplicationLayout& Layout;
+	uint32_t DataDesc;
+	uint32_t SequenceCounter{ 0 };
+	bool HasAckedSnapshot{ false };
+	std::vector<FReplicationValue> AckedSnapshot;
+	// the peer may have applied any of them, their fields are sent until one is acked
+	std::deque<FPendingDelta> PendingDeltas;
+	std::vector<FReplicationValue> CurrentSnapshot;
+};
+
+// apply the deltas of one FReplicationSender through the FProperty setters
+class CORE_API FReplicationReceiver
+{
+public:
+	FReplicationReceiver(const FClass* Class, uint32_t AckDataDesc = 0);
+
+	// Object keep the fields missing from the delta, return false when the delta is corrupt or from another layout of the class
+	bool Apply(void* Object, const uint8_t* Data, size_t Size);
+	bool Apply(void* Object, FMessageData& MessageData);
+
+	// ack of the last applied delta, body is a varint sequence
+	// return false when there is nothing new to acknowledge
+	bool BuildAck(FMessageData& MessageData);
+
+	// send the ack of the last applied delta, return the value of SConnection::Send, 0 when there is nothing to acknowledge
+	uint64_t SendAck(SConnection* Connection);
+
+	uint32_t GetLastAppliedSequence() const { return LastAppliedSequence; }
+
+private:
+	const FReplicationLayout& Layout;
+	uint32_t AckDataDesc;
+	uint32_t LastAppliedSequence{ 0 };
+	uint32_t LastAckedSequence{ 0 };
+};
+
+#pragma warning(pop)
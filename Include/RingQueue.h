@@ -0,0 +1,246 @@
+#pragma once
+#include <new>
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+#include "Queue.h"
+
+#define RING_QUEUE_CACHE_LINE_SIZE 64
+
+// bounded queue over a contiguous array of sequence numbered slots (Vyukov bounded queue)
+// capacity is rounded up to power of two, TryEnqueue return false when the queue is full
+// SPSC and MPSC skip the compare exchange on the single threaded side
+template<typename T, EQueueMode::Type Mode = EQueueMode::SPSC>
+class TRingQueue
+{
+	static constexpr bool IsMultiProducer = Mode != EQueueMode::SPSC;
+	static constexpr bool IsMultiConsumer = Mode == EQueueMode::MPMC;
+public:
+
+	TRingQueue(uint32_t InCapacity)
+	{
+		// the largest power of two of uint32_t, rounding up past it would never end
+		assert(InCapacity > 0 && InCapacity <= (1u << 31));
+		InCapacity = (std::min)(InCapacity, 1u << 31);
+		Capacity = 1;
+		while (Capacity < InCapacity) Capacity <<= 1;
+		Mask = Capacity - 1;
+		Slots = std::make_unique<FSlot[]>(Capacity);
+		for (uint64_t i = 0; i < Capacity; i++)
+			Slots[i].Sequence.store(i, std::memory_order_relaxed);
+	}
+
+	~TRingQueue()
+	{
+		Empty();
+	}
+
+	bool TryEnqueue(const T& Element) { return EmplaceImpl(Element); }
+	bool TryEnqueue(T&& Element) { return EmplaceImpl(std::move(Element)); }
+
+	// same signature as TQueue, so a ring queue can replace a linked queue
+	bool Enqueue(const T& Element) { return EmplaceImpl(Element); }
+	bool Enqueue(T&& Element) { return EmplaceImpl(std::move(Element)); }
+
+	bool TryDequeue(T& OutElement) { return Dequeue(OutElement); }
+
+	bool Dequeue(T& OutElement)
+	{
+		FSlot* Slot;
+		uint64_t Position = DequeuePosition.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Slot = &Slots[Position & Mask];
+			uint64_t Sequence = Slot->Sequence.load(std::memory_order_acquire);
+			int64_t Difference = int64_t(Sequence) - int64_t(Position + 1);
+			if (Difference == 0)
+			{
+				if (!IsMultiConsumer)
+				{
+					DequeuePosition.store(Position + 1, std::memory_order_relaxed);
+					break;
+				}
+				if (DequeuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (Difference < 0)
+			{
+				return false;
+			}
+			else
+			{
+				Position = DequeuePosition.load(std::memory_order_relaxed);
+			}
+		}
+		OutElement = std::move(*Slot->GetElement());
+		Slot->GetElement()->~T();
+		Slot->Sequence.store(Position + Mask + 1, std::memory_order_release);
+		return true;
+	}
+
+	// enqueue as many elements as fit in one claim, return the number of enqueued elements
+	template<typename TIterator>
+	uint32_t EnqueueBulk(TIterator First, uint32_t Count)
+	{
+		uint64_t Position = EnqueuePosition.load(std::memory_order_relaxed);
+		uint32_t Claimed;
+		for (;;)
+		{
+			Claimed = 0;
+			while (Claimed < Count && Claimed < Capacity &&
+				Slots[(Position + Claimed) & Mask].Sequence.load(std::memory_order_acquire) == Position + Claimed)
+				Claimed++;
+			if (Claimed == 0)
+			{
+				// a sequence ahead of Position only means another thread moved the cursor, full/empty is behind it
+				int64_t Difference = int64_t(Slots[Position & Mask].Sequence.load(std::memory_order_acquire)) - int64_t(Position);
+				if (Difference < 0)
+					return 0;
+				if (Difference > 0)
+					Position = EnqueuePosition.load(std::memory_order_relaxed);
+				continue;
+			}
+			if (!IsMultiProducer)
+			{
+				EnqueuePosition.store(Position + Claimed, std::memory_order_relaxed);
+				break;
+			}
+			if (EnqueuePosition.compare_exchange_weak(Position, Position + Claimed, std::memory_order_relaxed))
+				break;
+		}
+		for (uint32_t i = 0; i < Claimed; i++, ++First)
+		{
+			FSlot& Slot = Slots[(Position + i) & Mask];
+			new (Slot.Storage) T(std::move(*First));
+			Slot.Sequence.store(Position + i + 1, std::memory_order_release);
+		}
+		return Claimed;
+	}
+
+	// dequeue up to MaxCount elements in one claim, return the number of dequeued elements
+	template<typename TIterator>
+	uint32_t DequeueBulk(TIterator OutFirst, uint32_t MaxCount)
+	{
+		uint64_t Position = DequeuePosition.load(std::memory_order_relaxed);
+		uint32_t Claimed;
+		for (;;)
+		{
+			Claimed = 0;
+			while (Claimed < MaxCount && Claimed < Capacity &&
+				Slots[(Position + Claimed) & Mask].Sequence.load(std::memory_order_acquire) == Position + Claimed + 1)
+				Claimed++;
+			if (Claimed == 0)
+			{
+				// a sequence ahead of Position only means another thread moved the cursor, full/empty is behind it
+				int64_t Difference = int64_t(Slots[Position & Mask].Sequence.load(std::memory_order_acquire)) - int64_t(Position + 1);
+				if (Difference < 0)
+					return 0;
+				if (Difference > 0)
+					Position = DequeuePosition.load(std::memory_order_relaxed);
+				continue;
+			}
+			if (!IsMultiConsumer)
+			{
+				DequeuePosition.store(Position + Claimed, std::memory_order_relaxed);
+				break;
+			}
+			if (DequeuePosition.compare_exchange_weak(Position, Position + Claimed, std::memory_order_relaxed))
+				break;
+		}
+		for (uint32_t i = 0; i < Claimed; i++, ++OutFirst)
+		{
+			FSlot& Slot = Slots[(Position + i) & Mask];
+			*OutFirst = std::move(*Slot.GetElement());
+			Slot.GetElement()->~T();
+			Slot.Sequence.store(Position + i + Mask + 1, std::memory_order_release);
+		}
+		return Claimed;
+	}
+
+	void Empty()
+	{
+		T Element;
+		while (Dequeue(Element));
+	}
+
+	bool Pop()
+	{
+		T Element;
+		return Dequeue(Element);
+	}
+
+	// approximate when other threads are working on the queue
+	bool IsEmpty() const
+	{
+		return Size() == 0;
+	}
+
+	uint32_t Size() const
+	{
+		uint64_t Enqueued = EnqueuePosition.load(std::memory_order_acquire);
+		uint64_t Dequeued = DequeuePosition.load(std::memory_order_acquire);
+		return Enqueued > Dequeued ? uint32_t(Enqueued - Dequeued) : 0;
+	}
+
+	uint32_t GetCapacity() const { return Capacity; }
+
+private:
+
+	struct FSlot
+	{
+		T* GetElement() { return std::launder(reinterpret_cast<T*>(Storage)); }
+
+		std::atomic<uint64_t> Sequence;
+		alignas(T) unsigned char Storage[sizeof(T)];
+	};
+
+	template<typename TElement>
+	bool EmplaceImpl(TElement&& Element)
+	{
+		FSlot* Slot;
+		uint64_t Position = EnqueuePosition.load(std::memory_order_relaxed);
+		for (;;)
+		{
+			Slot = &Slots[Position & Mask];
+			uint64_t Sequence = Slot->Sequence.load(std::memory_order_acquire);
+			int64_t Difference = int64_t(Sequence) - int64_t(Position);
+			if (Difference == 0)
+			{
+				if (!IsMultiProducer)
+				{
+					EnqueuePosition.store(Position + 1, std::memory_order_relaxed);
+					break;
+				}
+				if (EnqueuePosition.compare_exchange_weak(Position, Position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (Difference < 0)
+			{
+				// full
+				return false;
+			}
+			else
+			{
+				Position = EnqueuePosition.load(std::memory_order_relaxed);
+			}
+		}
+		new (Slot->Storage) T(std::forward<TElement>(Element));
+		Slot->Sequence.store(Position + 1, std::memory_order_release);
+		return true;
+	}
+
+	alignas(RING_QUEUE_CACHE_LINE_SIZE) std::atomic<uint64_t> EnqueuePosition{ 0 };
+	alignas(RING_QUEUE_CACHE_LINE_SIZE) std::atomic<uint64_t> DequeuePosition{ 0 };
+	alignas(RING_QUEUE_CACHE_LINE_SIZE) std::unique_ptr<FSlot[]> Slots;
+	uint32_t Capacity;
+	uint32_t Mask;
+
+private:
+
+	TRingQueue(const TRingQueue&) = delete;
+
+	TRingQueue& operator=(const TRingQueue&) = delete;
+};
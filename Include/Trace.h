@@ -0,0 +1,110 @@
+#pragma once
+#include <atomic>
+#include <string>
+#include <cstdint>
+#include "CoreApi.h"
+
+// define TRACE_ENABLED to 0 to compile the TRACE_ macros out
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 1
+#endif // TRACE_ENABLED
+
+// events kept per thread, the oldest events are overwritten when the buffer is full, a power of two
+#ifndef TRACE_THREAD_BUFFER_CAPACITY
+#define TRACE_THREAD_BUFFER_CAPACITY 8192
+#endif // TRACE_THREAD_BUFFER_CAPACITY
+
+namespace ETracePhase
+{
+	enum Type : char
+	{
+		Begin = 'B',
+		End = 'E',
+		Instant = 'i',
+		Counter = 'C',
+	};
+}
+
+// Name and Category must be string literals or otherwise outlive the trace
+struct FTraceEvent
+{
+	// steady clock nanoseconds
+	int64_t Timestamp;
+	const char* Name;
+	const char* Category;
+	int64_t Value;
+	ETracePhase::Type Phase;
+};
+
+// flight recorder of begin/end/instant/counter events in per thread ring buffers,
+// written as a Chrome trace (chrome://tracing, ui.perfetto.dev) on demand
+class CORE_API FTrace
+{
+public:
+	static void Start();
+	static void Stop();
+
+	static bool IsEnabled() { return Enabled.load(std::memory_order_relaxed); }
+
+	static void Begin(const char* Name, const char* Category = "Core") { if (IsEnabled()) Record(ETracePhase::Begin, Name, Category, 0); }
+	static void End(const char* Name, const char* Category = "Core") { if (IsEnabled()) Record(ETracePhase::End, Name, Category, 0); }
+	static void Instant(const char* Name, const char* Category = "Core") { if (IsEnabled()) Record(ETracePhase::Instant, Name, Category, 0); }
+	static void Counter(const char* Name, int64_t Value, const char* Category = "Core") { if (IsEnabled()) Record(ETracePhase::Counter, Name, Category, Value); }
+
+	// name shown for the calling thread, the event buffer is only allocated by the first recorded event
+	static void SetThreadName(const std::string& ThreadName);
+
+	// write the events currently held by every thread buffer, return false when the file can't be written
+	// safe to call while other threads keep recording
+	static bool WriteChromeTrace(const std::string& Path);
+
+	static std::string ToChromeTrace();
+
+	// drop every recorded event
+	static void Clear();
+
+private:
+	friend struct FTraceScope;
+
+	static void Record(ETracePhase::Type Phase, const char* Name, const char* Category, int64_t Value);
+
+	static std::atomic<bool> Enabled;
+};
+
+struct FTraceScope
+{
+	FTraceScope(const char* Name, const char* Category = "Core")
+		: Name(Name)
+		, Category(Category)
+		, Recorded(FTrace::IsEnabled())
+	{
+		if (Recorded)
+			FTrace::Begin(Name, Category);
+	}
+
+	~FTraceScope()
+	{
+		// keep begin and end paired when tracing stop inside the scope
+		if (Recorded)
+			FTrace::Record(ETracePhase::End, Name, Category, 0);
+	}
+
+	const char* Name;
+	const char* Category;
+	bool Recorded;
+};
+
+#define TRACE_CONCAT_INNER(A, B) A##B
+#define TRACE_CONCAT(A, B) TRACE_CONCAT_INNER(A, B)
+
+#if TRACE_ENABLED
+#define TRACE_SCOPE(Name, ...) FTraceScope TRACE_CONCAT(TraceScope, __LINE__)(Name, ##__VA_ARGS__)
+#define TRACE_INSTANT(Name, ...) FTrace::Instant(Name, ##__VA_ARGS__)
+#define TRACE_COUNTER(Name, Value, ...) FTrace::Counter(Name, Value, ##__VA_ARGS__)
+#define TRACE_THREAD_NAME(Name) FTrace::SetThreadName(Name)
+#else
+#define TRACE_SCOPE(Name, ...)
+#define TRACE_INSTANT(Name, ...)
+#define TRACE_COUNTER(Name, Value, ...)
+#define TRACE_THREAD_NAME(Name)
+#endif // TRACE_ENABLED
@@ -0,0 +1,122 @@
+#pragma once
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+// byte level helpers of the reflection serializer and the replication, included by their source files only
+// multi byte values are little endian so every peer agree on the bytes
+// floating point values, enums and the serializer plan copies are memory as is, so hosts must be little endian too
+static_assert(std::endian::native == std::endian::little, "the reflection serializer and the replication copy host memory, big endian hosts aren't supported");
+
+namespace
+{
+	uint64_t ZigZagEncode(int64_t Value) { return (uint64_t(Value) << 1) ^ uint64_t(Value >> 63); }
+	int64_t ZigZagDecode(uint64_t Value) { return int64_t(Value >> 1) ^ -int64_t(Value & 1); }
+
+	size_t GetVarintSize(uint64_t Value)
+	{
+		size_t Size = 1;
+		for (; Value >= 0x80; Value >>= 7)
+			Size++;
+		return Size;
+	}
+
+	// count the bytes first, so the message body is allocated once
+	struct FSizeWriter
+	{
+		void Write(const void*, size_t Count) { Size += Count; }
+		void WriteByte(uint8_t) { Size++; }
+		size_t Size{ 0 };
+	};
+
+	struct FBufferWriter
+	{
+		void Write(const void* Source, size_t Size) { memcpy(Data, Source, Size); Data += Size; }
+		void WriteByte(uint8_t Byte) { *Data++ = Byte; }
+		uint8_t* Data;
+	};
+
+	struct FReader
+	{
+		bool Read(void* Target, size_t Size)
+		{
+			if (size_t(End - Data) < Size)
+				return false;
+			memcpy(Target, Data, Size);
+			Data += Size;
+			return true;
+		}
+
+		bool ReadByte(uint8_t& Byte)
+		{
+			if (Data == End)
+				return false;
+			Byte = *Data++;
+			return true;
+		}
+
+		bool ReadFixed32(uint32_t& Value)
+		{
+			if (size_t(End - Data) < sizeof(Value))
+				return false;
+			Value = uint32_t(Data[0]) | uint32_t(Data[1]) << 8 | uint32_t(Data[2]) << 16 | uint32_t(Data[3]) << 24;
+			Data += sizeof(Value);
+			return true;
+		}
+
+		bool ReadVarint(uint64_t& Value)
+		{
+			Value = 0;
+			for (uint32_t Shift = 0; Shift < 64; Shift += 7)
+			{
+				uint8_t Byte;
+				if (!ReadByte(Byte))
+					return false;
+				Value |= uint64_t(Byte & 0x7F) << Shift;
+				if ((Byte & 0x80) == 0)
+					return true;
+			}
+			return false;
+		}
+
+		const uint8_t* Data;
+		const uint8_t* End;
+	};
+
+	template<typename TWriter>
+	void WriteVarint(TWriter& Writer, uint64_t Value)
+	{
+		while (Value >= 0x80)
+		{
+			Writer.WriteByte(uint8_t(Value) | 0x80);
+			Value >>= 7;
+		}
+		Writer.WriteByte(uint8_t(Value));
+	}
+
+	template<typename TWriter>
+	void WriteFixed32(TWriter& Writer, uint32_t Value)
+	{
+		uint8_t Bytes[4] = { uint8_t(Value), uint8_t(Value >> 8), uint8_t(Value >> 16), uint8_t(Value >> 24) };
+		Writer.Write(Bytes, sizeof(Bytes));
+	}
+
+	// FNV-1a, bytes of integers are hashed little endian so every platform agree on the hash
+	constexpr uint32_t kFnvOffsetBasis = 2166136261u;
+	constexpr uint32_t kFnvPrime = 16777619u;
+
+	uint32_t HashString(uint32_t Hash, std::string_view String)
+	{
+		for (char Character : String)
+			Hash = (Hash ^ uint8_t(Character)) * kFnvPrime;
+		return Hash;
+	}
+
+	uint32_t HashUint32(uint32_t Hash, uint32_t Value)
+	{
+		for (uint32_t Shift = 0; Shift < 32; Shift += 8)
+			Hash = (Hash ^ uint8_t(Value >> Shift)) * kFnvPrime;
+		return Hash;
+	}
+}
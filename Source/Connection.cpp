@@ -2,18 +2,54 @@
 #include <asio.hpp>
 #include "Global.h"
 #include "ConnectionOwner.h"
+#include "Trace.h"
 #include <deque>
 
+// queued send, a shared message own only its header, the body belong to the broadcast buffer
+struct FSendEntry
+{
+	explicit FSendEntry(FMessageData&& InMessageData, std::shared_ptr<FMessageData> InSharedMessageData = nullptr)
+		: MessageData(std::move(InMessageData))
+		, SharedMessageData(std::move(InSharedMessageData))
+	{
+	}
+
+	FMessageData MessageData;
+	std::shared_ptr<FMessageData> SharedMessageData;
+
+	void* GetBody() { return SharedMessageData ? SharedMessageData->GetBody<void>() : MessageData.GetBody<void>(); }
+	uint32_t GetBodySize() { return MessageData.GetBodySize(); }
+	uint32_t GetSize() { return MessageData.GetHeaderSize() + GetBodySize(); }
+};
+
+// non owning buffer sequence, async_write copy the sequence it is given and the vector would be copied on every write
+struct FConstBufferView
+{
+	using value_type = asio::const_buffer;
+	using const_iterator = const asio::const_buffer*;
+
+	const_iterator begin() const { return First; }
+	const_iterator end() const { return Last; }
+
+	const_iterator First;
+	const_iterator Last;
+};
+
 struct SConnection::FImpl {
 	FImpl(IConnectionOwner& Owner, std::shared_ptr<FConnectionDelegate> ConnectionDelegate)
 		: Owner(Owner)
-		, IoContext(Owner.GetIoContext())
+		, IoContext(Owner.AcquireIoContext(IoShard))
 		, IoContextWriteStrand(IoContext)
 		, Socket(IoContext)
 		, RecvFrom(Owner.GetRecvQueue())
+#ifdef RECV_FROM_USE_RING_QUEUE
+		, RecvBackpressureTimer(IoContext)
+#endif // RECV_FROM_USE_RING_QUEUE
 	{
 	}
 	IConnectionOwner& Owner;
+	// shard of a sharded owner, UINT32_MAX when the io context is shared
+	uint32_t IoShard{ UINT32_MAX };
 	asio::io_context& IoContext;
 	asio::io_context::strand IoContextWriteStrand;
 	asio::ip::tcp::socket Socket;
@@ -24,18 +60,149 @@ struct SConnection::FImpl {
 	// free lock queue for send
 	TQueue<FMessageData, EQueueMode::MPSC> SendTo;
 #else
-	std::deque<FMessageData> SendTo;
+	std::deque<FSendEntry> SendTo;
+	// number of SendTo front messages in the current gathered write, 0 when idle
+	size_t WritingMessageCount{ 0 };
+	// buffers of the gathered write, kept until its completion and passed to async_write as a FConstBufferView
+	std::vector<asio::const_buffer> WriteBuffers;
+	// issue time of the gathered write, for LOG_SCOPE_TIME
+	std::chrono::steady_clock::time_point WriteStartTime;
 #endif // SENT_TO_USE_TQUEUE
+	std::atomic<uint64_t> WriteCounter{ 0 };
+	std::atomic<uint64_t> WriteMessageCounter{ 0 };
+	std::atomic<uint64_t> WriteByteCounter{ 0 };
 	std::atomic<bool> IsWriting{ false };
 	// free lock queue for recv
-	TQueue<FMessage, EQueueMode::MPSC>& RecvFrom;
+	FRecvQueue& RecvFrom;
 	// buffer for read
 	FMessageData MessageTemporaryRead;
+	// bytes [RecvBegin, RecvEnd) of RecvBuffer are received but not parsed, allocated by the first ReadSome
+	std::unique_ptr<uint8_t[]> RecvBuffer;
+	uint32_t RecvBegin{ 0 };
+	uint32_t RecvEnd{ 0 };
+	std::atomic<uint64_t> ReadCounter{ 0 };
+	std::atomic<uint64_t> ReadMessageCounter{ 0 };
+	std::atomic<uint64_t> ReadByteCounter{ 0 };
+	// updated by Send callers and the writing io thread
+	std::atomic<uint64_t> SendQueueMessages{ 0 };
+	std::atomic<uint64_t> SendQueueBytes{ 0 };
+	std::atomic<uint64_t> MaxSendQueueMessages{ 0 };
+	std::atomic<uint64_t> MaxSendQueueBytes{ 0 };
+	std::atomic<int64_t> LastActivityTime{ 0 };
+	std::atomic<uint64_t> DroppedMessages{ 0 };
+	// FSendQueueLimit, read by Send callers
+	std::atomic<uint64_t> HighWaterMessages{ 0 };
+	std::atomic<uint64_t> HighWaterBytes{ 0 };
+	std::atomic<uint64_t> LowWaterMessages{ 0 };
+	std::atomic<uint64_t> LowWaterBytes{ 0 };
+	std::atomic<ESlowConsumerPolicy> SlowConsumerPolicy{ ESlowConsumerPolicy::None };
+	// set when the queue reach the high water mark, cleared when it drain to the low water marks
+	std::atomic<bool> OverHighWater{ false };
+#ifdef RECV_FROM_USE_RING_QUEUE
+	// message waiting for free space in RecvFrom
+	FMessage PendingRecv;
+	asio::steady_timer RecvBackpressureTimer;
+#endif // RECV_FROM_USE_RING_QUEUE
 	// connection state
 	std::atomic<ESocketState> State{ ESocketState::Init };
 
 
 	std::shared_ptr<FConnectionDelegate> ConnectionDelegate;
+
+	// a connection pinned to a shard run on one thread, the write strand is not needed
+	bool IsPinned() { return IoShard != UINT32_MAX; }
+
+	// called on the io context by the destructor, the connection can't be used for OnErrorCode anymore
+	void CloseSocket()
+	{
+		if (!Socket.is_open())
+			return;
+		std::error_code ErrorCode;
+		Socket.shutdown(asio::ip::tcp::socket::shutdown_both, ErrorCode);
+		if (ErrorCode)
+			LOG_CATEGORY(LogNetwork, ELogLevel::kWarning, "<{:s}> Socket Error : {:s}\n", NetworkName, ErrorCode.message());
+		Socket.close();
+	}
+
+	static void UpdateMax(std::atomic<uint64_t>& Max, uint64_t Value)
+	{
+		uint64_t Current = Max.load(std::memory_order_relaxed);
+		while (Value > Current && !Max.compare_exchange_weak(Current, Value, std::memory_order_relaxed));
+	}
+
+	void OnSendQueued(uint64_t Bytes)
+	{
+		UpdateMax(MaxSendQueueMessages, SendQueueMessages.fetch_add(1, std::memory_order_relaxed) + 1);
+		UpdateMax(MaxSendQueueBytes, SendQueueBytes.fetch_add(Bytes, std::memory_order_relaxed) + Bytes);
+	}
+
+	void OnSendWritten(uint64_t Messages, uint64_t Bytes)
+	{
+		SendQueueMessages.fetch_sub(Messages, std::memory_order_relaxed);
+		SendQueueBytes.fetch_sub(Bytes, std::memory_order_relaxed);
+	}
+
+	bool IsOverHighWater(uint64_t Messages, uint64_t Bytes)
+	{
+		uint64_t HighWaterMessagesValue = HighWaterMessages.load(std::memory_order_relaxed);
+		uint64_t HighWaterBytesValue = HighWaterBytes.load(std::memory_order_relaxed);
+		return (HighWaterMessagesValue != 0 && Messages > HighWaterMessagesValue) || (HighWaterBytesValue != 0 && Bytes > HighWaterBytesValue);
+	}
+
+	bool IsBelowLowWater()
+	{
+		return SendQueueMessages.load(std::memory_order_relaxed) <= LowWaterMessages.load(std::memory_order_relaxed)
+			&& SendQueueBytes.load(std::memory_order_relaxed) <= LowWaterBytes.load(std::memory_order_relaxed);
+	}
+
+#ifndef SENT_TO_USE_TQUEUE
+	// keep the messages being written and the newest one
+	void DropOldest()
+	{
+		if (SlowConsumerPolicy.load(std::memory_order_relaxed) != ESlowConsumerPolicy::DropOldest)
+			return;
+		while (SendTo.size() > WritingMessageCount + 1
+			&& IsOverHighWater(SendQueueMessages.load(std::memory_order_relaxed), SendQueueBytes.load(std::memory_order_relaxed)))
+		{
+			auto Oldest = SendTo.begin() + WritingMessageCount;
+			OnSendWritten(1, Oldest->GetSize());
+			SendTo.erase(Oldest);
+			DroppedMessages.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+#endif // SENT_TO_USE_TQUEUE
+
+	void OnRead(std::size_t Length)
+	{
+		ReadCounter.fetch_add(1, std::memory_order_relaxed);
+		ReadByteCounter.fetch_add(Length, std::memory_order_relaxed);
+		LastActivityTime.store(FLogClock::Now(), std::memory_order_relaxed);
+	}
+
+	void OnWrite(std::size_t Length)
+	{
+		WriteCounter.fetch_add(1, std::memory_order_relaxed);
+		WriteByteCounter.fetch_add(Length, std::memory_order_relaxed);
+		LastActivityTime.store(FLogClock::Now(), std::memory_order_relaxed);
+	}
+
+	template<typename THandler>
+	void PostWrite(THandler&& Handler)
+	{
+		if (IsPinned())
+			asio::post(IoContext, std::forward<THandler>(Handler));
+		else
+			IoContextWriteStrand.post(std::forward<THandler>(Handler));
+	}
+
+	template<typename TBuffers, typename THandler>
+	void AsyncWrite(const TBuffers& Buffers, THandler&& Handler)
+	{
+		if (IsPinned())
+			asio::async_write(Socket, Buffers, std::forward<THandler>(Handler));
+		else
+			asio::async_write(Socket, Buffers, IoContextWriteStrand.wrap(std::forward<THandler>(Handler)));
+	}
 };
 
 SConnection::SConnection(IConnectionOwner& Owner, std::shared_ptr<FConnectionDelegate> ConnectionDelegate)
@@ -46,19 +213,25 @@ SConnection::SConnection(IConnectionOwner& Owner, std::shared_ptr<FConnectionDel
 
 SConnection::~SConnection()
 {
+	Impl->Owner.AddClosedConnectionStats(GetStats());
+	if (Impl->IsPinned() && !Impl->IoContext.get_executor().running_in_this_thread())
+	{
+		// the socket belong to the shard thread, the shard close it and free Impl later, don't wait for it
+		asio::post(Impl->IoContext, [Impl = std::move(Impl)]() {
+			Impl->CloseSocket();
+			Impl->Owner.ReleaseIoContext(Impl->IoShard);
+			Impl->Owner.DecreaseConnectionCounter();
+			});
+		return;
+	}
 	std::promise<void> Promise;
 	std::future<void> Future = Promise.get_future();
 	asio::dispatch(Impl->IoContext, [&]() mutable {
-		if (Impl->Socket.is_open())
-		{
-			std::error_code ErrorCode;
-			Impl->Socket.shutdown(asio::ip::tcp::socket::shutdown_both, ErrorCode);
-			if (ErrorCode) OnErrorCode(ErrorCode);
-			Impl->Socket.close();
-		}
+		Impl->CloseSocket();
 		Promise.set_value();
 		});
 	Future.get();
+	Impl->Owner.ReleaseIoContext(Impl->IoShard);
 	Impl->Owner.DecreaseConnectionCounter();
 }
 
@@ -81,49 +254,177 @@ void SConnection::Disconnect()
 }
 
 uint64_t SConnection::Send(const FMessageData& MessageData)
+{
+	if (!AdmitSend(const_cast<FMessageData&>(MessageData).GetSize(), false))
+		return 0;
+	return QueueSend(MessageData);
+}
+
+uint64_t SConnection::Send(FMessageData&& MessageData)
+{
+	if (!AdmitSend(MessageData.GetSize(), false))
+		return 0;
+	return QueueSend(std::move(MessageData));
+}
+
+uint64_t SConnection::Send(std::shared_ptr<FMessageData> SharedMessageData)
+{
+	if (!AdmitSend(SharedMessageData->GetSize(), false))
+		return 0;
+	return QueueSend(std::move(SharedMessageData));
+}
+
+uint64_t SConnection::TrySend(const FMessageData& MessageData)
+{
+	if (!AdmitSend(const_cast<FMessageData&>(MessageData).GetSize(), true))
+		return 0;
+	return QueueSend(MessageData);
+}
+
+uint64_t SConnection::TrySend(FMessageData&& MessageData)
+{
+	if (!AdmitSend(MessageData.GetSize(), true))
+		return 0;
+	return QueueSend(std::move(MessageData));
+}
+
+uint64_t SConnection::TrySend(std::shared_ptr<FMessageData> SharedMessageData)
+{
+	if (!AdmitSend(SharedMessageData->GetSize(), true))
+		return 0;
+	return QueueSend(std::move(SharedMessageData));
+}
+
+void SConnection::SetSendQueueLimit(const FSendQueueLimit& SendQueueLimit)
+{
+	Impl->HighWaterMessages.store(SendQueueLimit.HighWaterMessages, std::memory_order_relaxed);
+	Impl->HighWaterBytes.store(SendQueueLimit.HighWaterBytes, std::memory_order_relaxed);
+	Impl->LowWaterMessages.store(SendQueueLimit.LowWaterMessages, std::memory_order_relaxed);
+	Impl->LowWaterBytes.store(SendQueueLimit.LowWaterBytes, std::memory_order_relaxed);
+	Impl->SlowConsumerPolicy.store(SendQueueLimit.Policy, std::memory_order_relaxed);
+}
+
+FSendQueueLimit SConnection::GetSendQueueLimit()
+{
+	return FSendQueueLimit{
+		Impl->HighWaterMessages.load(std::memory_order_relaxed),
+		Impl->HighWaterBytes.load(std::memory_order_relaxed),
+		Impl->LowWaterMessages.load(std::memory_order_relaxed),
+		Impl->LowWaterBytes.load(std::memory_order_relaxed),
+		Impl->SlowConsumerPolicy.load(std::memory_order_relaxed) };
+}
+
+bool SConnection::IsWritable()
+{
+	return !Impl->IsOverHighWater(Impl->SendQueueMessages.load(std::memory_order_relaxed), Impl->SendQueueBytes.load(std::memory_order_relaxed));
+}
+
+bool SConnection::AdmitSend(uint64_t Bytes, bool IsTrySend)
+{
+	uint64_t Messages = Impl->SendQueueMessages.load(std::memory_order_relaxed);
+	if (Messages == 0 || !Impl->IsOverHighWater(Messages + 1, Impl->SendQueueBytes.load(std::memory_order_relaxed) + Bytes))
+		return true;
+	Impl->OverHighWater.store(true, std::memory_order_relaxed);
+	if (IsTrySend)
+		return false;
+	switch (Impl->SlowConsumerPolicy.load(std::memory_order_relaxed))
+	{
+	case ESlowConsumerPolicy::Disconnect:
+		LOG_CATEGORY(LogNetwork, ELogLevel::kWarning, "<{:s}> Send Queue Over High Water Mark, Disconnect", Impl->NetworkName);
+		Disconnect();
+		[[fallthrough]];
+#ifdef SENT_TO_USE_TQUEUE
+	// the lock free send queue can't drop queued messages
+	case ESlowConsumerPolicy::DropOldest:
+#endif // SENT_TO_USE_TQUEUE
+	case ESlowConsumerPolicy::DropNewest:
+		Impl->DroppedMessages.fetch_add(1, std::memory_order_relaxed);
+		return false;
+	default:
+		return true;
+	}
+}
+
+void SConnection::CheckWritable()
+{
+	if (!Impl->OverHighWater.load(std::memory_order_relaxed) || !Impl->IsBelowLowWater())
+		return;
+	if (Impl->OverHighWater.exchange(false, std::memory_order_relaxed))
+		Impl->Owner.PushTask([Self = shared_from_this()]{ Self->Impl->Owner.OnConnectionWritable(Self); });
+}
+
+uint64_t SConnection::QueueSend(const FMessageData& MessageData)
 {
 	uint64_t SequenceNumber = Impl->SequenceNumber++;
 	const_cast<FMessageData&>(MessageData).SetSequenceNumber(SequenceNumber);
+	Impl->OnSendQueued(const_cast<FMessageData&>(MessageData).GetSize());
 #ifdef SENT_TO_USE_TQUEUE
 	Impl->SendTo.Enqueue(MessageData);
 	bool Expected = false;
 	if (Impl->IsWriting.compare_exchange_strong(Expected, true))
-		Impl->IoContextWriteStrand.post([this, Self = shared_from_this()]{ WriteHeader(); });
+		Impl->PostWrite([this, Self = shared_from_this()]{ WriteHeader(); });
 #else
-	Impl->IoContextWriteStrand.post(
-		[this, Self = shared_from_this(), MessageData = MessageData] {
+	Impl->PostWrite(
+		[this, Self = shared_from_this(), MessageData = MessageData]() mutable {
 			Impl->SendTo.emplace_back(std::move(MessageData));
-			if (Impl->SendTo.size() <= 1)
+			Impl->DropOldest();
+			if (Impl->WritingMessageCount == 0)
 			{
-				WriteHeader();
+				WriteMessages();
 			}
 		});
 #endif // SENT_TO_USE_TQUEUE
 	return SequenceNumber;
 }
 
-uint64_t SConnection::Send(FMessageData&& MessageData)
+uint64_t SConnection::QueueSend(FMessageData&& MessageData)
 {
 	uint64_t SequenceNumber = Impl->SequenceNumber++;
 	const_cast<FMessageData&>(MessageData).SetSequenceNumber(SequenceNumber);
+	Impl->OnSendQueued(const_cast<FMessageData&>(MessageData).GetSize());
 #ifdef SENT_TO_USE_TQUEUE
 	Impl->SendTo.Enqueue(std::move(MessageData));
 	bool Expected = false;
 	if (Impl->IsWriting.compare_exchange_strong(Expected, true)) 
-		Impl->IoContextWriteStrand.post([this, Self = shared_from_this()] {WriteHeader();});
+		Impl->PostWrite([this, Self = shared_from_this()] {WriteHeader();});
 #else
-	Impl->IoContextWriteStrand.post(
-		[this, Self = shared_from_this(), MessageData = std::move(MessageData)]{
+	Impl->PostWrite(
+		[this, Self = shared_from_this(), MessageData = std::move(MessageData)]() mutable {
 			Impl->SendTo.emplace_back(std::move(MessageData));
-			if (Impl->SendTo.size() <= 1)
+			Impl->DropOldest();
+			if (Impl->WritingMessageCount == 0)
 			{
-				WriteHeader();
+				WriteMessages();
 			}
 		});
 #endif // SENT_TO_USE_TQUEUE
 	return SequenceNumber;
 }
 
+uint64_t SConnection::QueueSend(std::shared_ptr<FMessageData> SharedMessageData)
+{
+#ifdef SENT_TO_USE_TQUEUE
+	return QueueSend(FMessageData(*SharedMessageData));
+#else
+	uint64_t SequenceNumber = Impl->SequenceNumber++;
+	// own a copy of the header for the sequence number, share the body
+	FMessageData HeaderData;
+	*HeaderData.GetHeader() = *SharedMessageData->GetHeader();
+	HeaderData.SetSequenceNumber(SequenceNumber);
+	Impl->OnSendQueued(SharedMessageData->GetSize());
+	Impl->PostWrite(
+		[this, Self = shared_from_this(), HeaderData = std::move(HeaderData), SharedMessageData = std::move(SharedMessageData)]() mutable {
+			Impl->SendTo.emplace_back(std::move(HeaderData), std::move(SharedMessageData));
+			Impl->DropOldest();
+			if (Impl->WritingMessageCount == 0)
+			{
+				WriteMessages();
+			}
+		});
+	return SequenceNumber;
+#endif // SENT_TO_USE_TQUEUE
+}
+
 void SConnection::OnErrorCode(const std::error_code& ErrorCode)
 {
 	assert(Impl->Owner.RunInIoContext());
@@ -131,7 +432,7 @@ void SConnection::OnErrorCode(const std::error_code& ErrorCode)
 	{
 		// remote is shutdown if eof 
 	}
-	GLogger->Log(ELogLevel::kWarning, "<{:s}> Socket Error : {:s}\n", Impl->NetworkName, ErrorCode.message());
+	LOG_CATEGORY(LogNetwork, ELogLevel::kWarning, "<{:s}> Socket Error : {:s}\n", Impl->NetworkName, ErrorCode.message());
 	ESocketState ExpectedSocketState = ESocketState::Connected;
 	if (Impl->State.compare_exchange_strong(ExpectedSocketState, ESocketState::Disconnected))
 		Impl->Owner.PushTask([Self = shared_from_this()]{ Self->Impl->Owner.OnConnectionDisconnected(Self); });
@@ -141,18 +442,19 @@ void SConnection::ReadHeader()
 {
 	auto Self(this->shared_from_this());
 	asio::async_read(Impl->Socket, asio::buffer(Impl->MessageTemporaryRead.GetHeader(), Impl->MessageTemporaryRead.GetHeaderSize()),
-		[this, Self](std::error_code ErrorCode, std::size_t length)
+		[this, Self](std::error_code ErrorCode, std::size_t Length)
 		{
+			TRACE_SCOPE("SConnection::ReadHeader", "Network");
 			if (!ErrorCode)
 			{
+				Impl->OnRead(Length);
 				if (Impl->MessageTemporaryRead.GetBodySize() > 0)
 				{
 					Impl->MessageTemporaryRead.UpdateBodySize();
 					ReadBody();
 				}
-				else
+				else if (DeliverMessage(std::move(Impl->MessageTemporaryRead)))
 				{
-					Impl->RecvFrom.Enqueue(FMessage{ Self, std::move(Impl->MessageTemporaryRead) });
 					ReadHeader();
 				}
 			}
@@ -167,12 +469,14 @@ void SConnection::ReadBody()
 {
 	auto Self(this->shared_from_this());
 	asio::async_read(Impl->Socket, asio::buffer(Impl->MessageTemporaryRead.GetBody<void>(), Impl->MessageTemporaryRead.GetBodySize()),
-		[this, Self](std::error_code ErrorCode, std::size_t length)
+		[this, Self](std::error_code ErrorCode, std::size_t Length)
 		{
+			TRACE_SCOPE("SConnection::ReadBody", "Network");
 			if (!ErrorCode)
 			{
-				Impl->RecvFrom.Enqueue(FMessage{ Self, std::move(Impl->MessageTemporaryRead) });
-				ReadHeader();
+				Impl->OnRead(Length);
+				if (DeliverMessage(std::move(Impl->MessageTemporaryRead)))
+					ReadHeader();
 			}
 			else
 			{
@@ -181,29 +485,154 @@ void SConnection::ReadBody()
 		});
 }
 
-void SConnection::WriteHeader()
+void SConnection::ReadSome()
 {
+	if (!Impl->RecvBuffer)
+		Impl->RecvBuffer.reset(new uint8_t[RECV_BUFFER_SIZE]);
 	auto Self(this->shared_from_this());
-#ifdef SENT_TO_USE_TQUEUE
-	asio::async_write(Impl->Socket, asio::buffer(Impl->SendTo.Peek()->GetHeader(), Impl->SendTo.Peek()->GetHeaderSize()),
+	asio::async_read_some(Impl->Socket, asio::buffer(Impl->RecvBuffer.get() + Impl->RecvEnd, RECV_BUFFER_SIZE - Impl->RecvEnd),
+		[this, Self](std::error_code ErrorCode, std::size_t Length)
+		{
+			TRACE_SCOPE("SConnection::ReadSome", "Network");
+			if (!ErrorCode)
+			{
+				Impl->OnRead(Length);
+				Impl->RecvEnd += static_cast<uint32_t>(Length);
+				ParseRecvBuffer();
+			}
+			else
+			{
+				OnErrorCode(ErrorCode);
+			}
+		});
+}
+
+void SConnection::ParseRecvBuffer()
+{
+	constexpr uint32_t HeaderSize = sizeof(FMessageData::FHeader);
+	while (Impl->RecvEnd - Impl->RecvBegin >= HeaderSize)
+	{
+		uint8_t* Frame = Impl->RecvBuffer.get() + Impl->RecvBegin;
+		uint32_t Available = Impl->RecvEnd - Impl->RecvBegin;
+		// frame may be unaligned in the buffer
+		uint32_t BodySize;
+		memcpy(&BodySize, Frame + offsetof(FMessageData::FHeader, BodySize), sizeof(BodySize));
+		uint64_t FrameSize = uint64_t(HeaderSize) + BodySize;
+		if (FrameSize > RECV_BUFFER_SIZE)
+		{
+			ReadLargeFrame(Frame, Available);
+			return;
+		}
+		if (Available < FrameSize)
+			break;
+		FMessageData MessageData;
+		MessageData.SetFullData(Frame, static_cast<uint32_t>(FrameSize));
+		Impl->RecvBegin += static_cast<uint32_t>(FrameSize);
+		if (!DeliverMessage(std::move(MessageData)))
+			return;
+	}
+	// move the partial frame to the front
+	uint32_t Remaining = Impl->RecvEnd - Impl->RecvBegin;
+	if (Remaining > 0 && Impl->RecvBegin > 0)
+		memmove(Impl->RecvBuffer.get(), Impl->RecvBuffer.get() + Impl->RecvBegin, Remaining);
+	Impl->RecvBegin = 0;
+	Impl->RecvEnd = Remaining;
+	ReadSome();
+}
+
+void SConnection::ReadLargeFrame(const uint8_t* Frame, uint32_t Available)
+{
+	// frame bigger than the recv buffer, read the rest straight into a dedicated message
+	Impl->MessageTemporaryRead.SetFullData(Frame, Available);
+	Impl->MessageTemporaryRead.UpdateBodySize();
+	Impl->RecvBegin = Impl->RecvEnd = 0;
+	auto Self(this->shared_from_this());
+	uint8_t* Remainder = reinterpret_cast<uint8_t*>(Impl->MessageTemporaryRead.GetHeader()) + Available;
+	asio::async_read(Impl->Socket, asio::buffer(Remainder, Impl->MessageTemporaryRead.GetSize() - Available),
+		[this, Self](std::error_code ErrorCode, std::size_t Length)
+		{
+			TRACE_SCOPE("SConnection::ReadLargeFrame", "Network");
+			if (!ErrorCode)
+			{
+				Impl->OnRead(Length);
+				if (DeliverMessage(std::move(Impl->MessageTemporaryRead)))
+					ReadSome();
+			}
+			else
+			{
+				OnErrorCode(ErrorCode);
+			}
+		});
+}
+
+void SConnection::ContinueRead()
+{
+#ifdef RECV_USE_BUFFERED_READ
+	ParseRecvBuffer();
 #else
-	asio::async_write(Impl->Socket, asio::buffer(Impl->SendTo.front().GetHeader(), Impl->SendTo.front().GetHeaderSize()),
-#endif // SENT_TO_USE_TQUEUE
-		Impl->IoContextWriteStrand.wrap([this, Self](std::error_code ErrorCode, std::size_t Length)
+	ReadHeader();
+#endif // RECV_USE_BUFFERED_READ
+}
+
+bool SConnection::DeliverMessage(FMessageData&& MessageData)
+{
+	Impl->ReadMessageCounter.fetch_add(1, std::memory_order_relaxed);
+#ifdef RECV_FROM_USE_RING_QUEUE
+	Impl->PendingRecv = FMessage{ shared_from_this(), std::move(MessageData) };
+	if (Impl->RecvFrom.TryEnqueue(std::move(Impl->PendingRecv)))
+		return true;
+	WaitRecvQueue();
+	return false;
+#else
+	Impl->RecvFrom.Enqueue(FMessage{ shared_from_this(), std::move(MessageData) });
+	return true;
+#endif // RECV_FROM_USE_RING_QUEUE
+}
+
+#ifdef RECV_FROM_USE_RING_QUEUE
+void SConnection::WaitRecvQueue()
+{
+	// recv queue is full, stop reading so tcp flow control push back on the remote
+	auto Self(this->shared_from_this());
+	Impl->RecvBackpressureTimer.expires_after(std::chrono::milliseconds(1));
+	Impl->RecvBackpressureTimer.async_wait([this, Self](std::error_code ErrorCode)
+		{
+			if (ErrorCode)
+			{
+				OnErrorCode(ErrorCode);
+			}
+			else if (Impl->RecvFrom.TryEnqueue(std::move(Impl->PendingRecv)))
+			{
+				ContinueRead();
+			}
+			else
+			{
+				WaitRecvQueue();
+			}
+		});
+}
+#endif // RECV_FROM_USE_RING_QUEUE
+
+#ifdef SENT_TO_USE_TQUEUE
+void SConnection::WriteHeader()
+{
+	auto Self(this->shared_from_this());
+	Impl->AsyncWrite(asio::buffer(Impl->SendTo.Peek()->GetHeader(), Impl->SendTo.Peek()->GetHeaderSize()),
+		[this, Self](std::error_code ErrorCode, std::size_t Length)
 			{
+				TRACE_SCOPE("SConnection::WriteHeader", "Network");
 				if (!ErrorCode)
 				{
-#ifdef SENT_TO_USE_TQUEUE
+					Impl->OnWrite(Length);
 					if (Impl->SendTo.Peek()->GetBodySize() > 0)
-#else
-					if (Impl->SendTo.front().GetBodySize() > 0)
-#endif // SENT_TO_USE_TQUEUE
 					{
 						WriteBody();
 					}
 					else
 					{
-#ifdef SENT_TO_USE_TQUEUE
+						Impl->WriteMessageCounter.fetch_add(1, std::memory_order_relaxed);
+						Impl->OnSendWritten(1, Length);
+						CheckWritable();
 						Impl->SendTo.Pop();
 						if (Impl->SendTo.Peek() != nullptr)
 						{
@@ -215,36 +644,29 @@ void SConnection::WriteHeader()
 							bool IsNeedWriteHeader = Impl->IsWriting.compare_exchange_strong(Expected, false);
 							assert(IsNeedWriteHeader);
 						}
-#else
-						Impl->SendTo.pop_front();
-						if (!Impl->SendTo.empty())
-						{
-							WriteHeader();
-						}
-#endif // SENT_TO_USE_TQUEUE
 					}
 				}
 				else
 				{
 					OnErrorCode(ErrorCode);
 				}
-			}));
+			});
 }
 
 void SConnection::WriteBody()
 {
 	auto Self(this->shared_from_this());
 
-#ifdef SENT_TO_USE_TQUEUE
-	asio::async_write(Impl->Socket, asio::buffer(Impl->SendTo.Peek()->GetBody<void>(), Impl->SendTo.Peek()->GetBodySize()),
-#else
-	asio::async_write(Impl->Socket, asio::buffer(Impl->SendTo.front().GetBody<void>(), Impl->SendTo.front().GetBodySize()),
-#endif // SENT_TO_USE_TQUEUE
-		Impl->IoContextWriteStrand.wrap([this, Self](std::error_code ErrorCode, std::size_t Length)
+	Impl->AsyncWrite(asio::buffer(Impl->SendTo.Peek()->GetBody<void>(), Impl->SendTo.Peek()->GetBodySize()),
+		[this, Self](std::error_code ErrorCode, std::size_t Length)
 			{
+				TRACE_SCOPE("SConnection::WriteBody", "Network");
 				if (!ErrorCode)
 				{
-#ifdef SENT_TO_USE_TQUEUE
+					Impl->OnWrite(Length);
+					Impl->WriteMessageCounter.fetch_add(1, std::memory_order_relaxed);
+					Impl->OnSendWritten(1, Impl->SendTo.Peek()->GetSize());
+					CheckWritable();
 					Impl->SendTo.Pop();
 					if (Impl->SendTo.Peek() != nullptr)
 					{
@@ -256,19 +678,104 @@ void SConnection::WriteBody()
 						bool IsNeedWriteHeader = Impl->IsWriting.compare_exchange_strong(Expected, false);
 						assert(IsNeedWriteHeader);
 					}
+				}
+				else
+				{
+					OnErrorCode(ErrorCode);
+				}
+			});
+}
+#endif // SENT_TO_USE_TQUEUE
+
+void SConnection::WriteMessages()
+{
+#ifdef SENT_TO_USE_TQUEUE
+	WriteHeader();
 #else
-					Impl->SendTo.pop_front();
+#if LOG_SCOPE_TIME_ENABLED
+	// from the issue of the gathered write to its completion
+	static const FLogScopeTimeSite WriteMessagesSite("SConnection::WriteMessages", __FILE__, __LINE__);
+	Impl->WriteStartTime = std::chrono::steady_clock::now();
+#endif // LOG_SCOPE_TIME_ENABLED
+	auto Self(this->shared_from_this());
+	assert(Impl->WritingMessageCount == 0 && !Impl->SendTo.empty());
+	// header and body are contiguous, one buffer per message, shared message need a second buffer for the body
+	size_t WriteBytes = 0;
+	size_t WritingMessageCount = 0;
+	Impl->WriteBuffers.clear();
+	for (auto& SendEntry : Impl->SendTo)
+	{
+		size_t NumBuffers = SendEntry.SharedMessageData ? 2 : 1;
+		if (WritingMessageCount > 0 && Impl->WriteBuffers.size() + NumBuffers > SEND_GATHER_MAX_BUFFERS) break;
+		if (WritingMessageCount > 0 && WriteBytes + SendEntry.GetSize() > SEND_GATHER_MAX_BYTES) break;
+		if (SendEntry.SharedMessageData)
+		{
+			Impl->WriteBuffers.emplace_back(asio::buffer(SendEntry.MessageData.GetHeader(), SendEntry.MessageData.GetHeaderSize()));
+			Impl->WriteBuffers.emplace_back(asio::buffer(SendEntry.GetBody(), SendEntry.GetBodySize()));
+		}
+		else
+		{
+			Impl->WriteBuffers.emplace_back(asio::buffer(SendEntry.MessageData.GetHeader(), SendEntry.MessageData.GetSize()));
+		}
+		WriteBytes += SendEntry.GetSize();
+		WritingMessageCount++;
+	}
+	Impl->WritingMessageCount = WritingMessageCount;
+	Impl->AsyncWrite(FConstBufferView{ Impl->WriteBuffers.data(), Impl->WriteBuffers.data() + Impl->WriteBuffers.size() },
+		[this, Self](std::error_code ErrorCode, std::size_t Length)
+			{
+				TRACE_SCOPE("SConnection::WriteMessages", "Network");
+#if LOG_SCOPE_TIME_ENABLED
+				FLogScopeTimeProfiler::RecordSince(WriteMessagesSite, Impl->WriteStartTime);
+#endif // LOG_SCOPE_TIME_ENABLED
+				if (!ErrorCode)
+				{
+					Impl->OnWrite(Length);
+					Impl->WriteMessageCounter.fetch_add(Impl->WritingMessageCount, std::memory_order_relaxed);
+					Impl->OnSendWritten(Impl->WritingMessageCount, Length);
+					Impl->SendTo.erase(Impl->SendTo.begin(), Impl->SendTo.begin() + Impl->WritingMessageCount);
+					Impl->WritingMessageCount = 0;
+					CheckWritable();
 					if (!Impl->SendTo.empty())
 					{
-						WriteHeader();
+						WriteMessages();
 					}
-#endif // SENT_TO_USE_TQUEUE
 				}
 				else
 				{
 					OnErrorCode(ErrorCode);
 				}
-			}));
+			});
+#endif // SENT_TO_USE_TQUEUE
+}
+
+FConnectionIoCounter SConnection::GetWriteCounter()
+{
+	return FConnectionIoCounter{
+		Impl->WriteCounter.load(std::memory_order_relaxed),
+		Impl->WriteMessageCounter.load(std::memory_order_relaxed),
+		Impl->WriteByteCounter.load(std::memory_order_relaxed) };
+}
+
+FConnectionIoCounter SConnection::GetReadCounter()
+{
+	return FConnectionIoCounter{
+		Impl->ReadCounter.load(std::memory_order_relaxed),
+		Impl->ReadMessageCounter.load(std::memory_order_relaxed),
+		Impl->ReadByteCounter.load(std::memory_order_relaxed) };
+}
+
+FConnectionStats SConnection::GetStats()
+{
+	return FConnectionStats{
+		GetReadCounter(),
+		GetWriteCounter(),
+		Impl->SendQueueMessages.load(std::memory_order_relaxed),
+		Impl->SendQueueBytes.load(std::memory_order_relaxed),
+		Impl->MaxSendQueueMessages.load(std::memory_order_relaxed),
+		Impl->MaxSendQueueBytes.load(std::memory_order_relaxed),
+		Impl->LastActivityTime.load(std::memory_order_relaxed),
+		Impl->DroppedMessages.load(std::memory_order_relaxed) };
 }
 
 void SConnection::ConnectToServer()
@@ -289,7 +796,11 @@ void SConnection::ConnectToRemote()
 {
 	Impl->NetworkName = std::format("{:s}:{:d}", Impl->Socket.remote_endpoint().address().to_string(), Impl->Socket.remote_endpoint().port());
 	Impl->Owner.PushTask([Self = shared_from_this()]{ Self->Impl->Owner.OnConnectionConnected(Self); });
+#ifdef RECV_USE_BUFFERED_READ
+	ReadSome();
+#else
 	ReadHeader();
+#endif // RECV_USE_BUFFERED_READ
 }
 
 void SConnection::ConnectFailed()
@@ -2,6 +2,9 @@
 #include "asio.hpp"
 #include "Global.h"
 #include "Connection.h"
+#include "Trace.h"
+
+DEFINE_LOG_CATEGORY(LogNetwork)
 
 struct FTcpServer::FImpl 
 {
@@ -10,7 +13,7 @@ struct FTcpServer::FImpl
 		if (InNumberOfWorkers == 0)
 			InNumberOfWorkers = std::thread::hardware_concurrency();
 
-		GLogger->Log(ELogLevel::kInfo, "ConnectionManager Worker Thread Count {:d}", InNumberOfWorkers);
+		LOG_CATEGORY(LogNetwork, ELogLevel::kInfo, "ConnectionManager Worker Thread Count {:d}", InNumberOfWorkers);
 		for (uint32_t i = 0; i < InNumberOfWorkers; i++) {
 			IoWorkers.emplace_back(std::make_unique<FIoWorker>(InMaxNumOfConnectionsPerIoWorker));
 		}
@@ -92,25 +95,55 @@ FTcpClientManager& FTcpClientManager::Instance()
 }
 
 struct IConnectionOwner::FImpl {
+	// io context pinned to one thread, connections of the shard need no write strand
+	struct FIoShard
+	{
+		FIoShard()
+			: IoContext(1)
+			, IdleWorker(new asio::io_context::work(IoContext))
+		{
+		}
+
+		asio::io_context IoContext;
+		std::unique_ptr<asio::io_context::work> IdleWorker;
+		std::thread Thread;
+		std::atomic<uint32_t> ConnectionCounter{ 0 };
+	};
+
 	FImpl()
 		: IoContext()
-		, Acceptor(IoContext)
 		, IdleWorkerPtr(new asio::io_context::work(IoContext))
+#ifdef RECV_FROM_USE_RING_QUEUE
+		, RecvFrom(RECV_FROM_RING_QUEUE_CAPACITY)
+#endif // RECV_FROM_USE_RING_QUEUE
 	{
 	}
 	asio::io_context IoContext;
-	asio::ip::tcp::acceptor Acceptor;
+	// more than one when CServer::Run bind acceptors with SO_REUSEPORT
+	std::vector<std::unique_ptr<asio::ip::tcp::acceptor>> Acceptors;
 	std::vector<std::thread> IoContextThreads;
 	std::unique_ptr<asio::io_context::work> IdleWorkerPtr;
 
-	TQueue<FMessage, EQueueMode::MPSC> RecvFrom;
+	EIoShardBalance IoShardBalance{ EIoShardBalance::RoundRobin };
+	std::vector<std::unique_ptr<FIoShard>> IoShards;
+	std::atomic<uint32_t> NextIoShard{ 0 };
+
+	FRecvQueue RecvFrom;
 	std::atomic<uint32_t> ConnectionCounter{ 0 };
-	TQueue<std::function<void()>, EQueueMode::MPSC> Tasks;
+	TQueue<std::function<void()>, EQueueMode::MPSC, EQueueNodeAllocator::Pool> Tasks;
+	// reusable buffer for ProcessMessage(MaxBatch)
+	std::vector<FMessage> MessageBatch;
 
 	uint32_t ConnectedConnection{ 0 };
 	std::vector<std::shared_ptr<SConnection>> WaitCleanConnections;
 	std::unordered_map<std::string, std::shared_ptr<SConnection>> ConnectionMap;
 
+	// counters of destroyed connections, connections are destroyed on any thread
+	std::mutex ClosedStatsMutex;
+	FConnectionIoCounter ClosedRead{};
+	FConnectionIoCounter ClosedWrite{};
+	uint64_t ClosedDroppedMessages{ 0 };
+
 #ifndef NDEBUG
 	// Check default OnConnectionConnected and OnConnectionDisconnected must be coexist
 	bool DefaultConnectedAndDisconnectedUsageFlag{ false };
@@ -140,7 +173,7 @@ struct IConnectionOwner::FImpl {
 #endif // NDEBUG
 };
 
-IConnectionOwner::IConnectionOwner(uint32_t ThreadNumber)
+IConnectionOwner::IConnectionOwner(uint32_t ThreadNumber, EIoContextMode IoContextMode, EIoShardBalance IoShardBalance)
 	: Impl(new FImpl())
 {
 #ifndef NDEBUG
@@ -148,16 +181,35 @@ IConnectionOwner::IConnectionOwner(uint32_t ThreadNumber)
 #endif // NDEBUG
 	if (ThreadNumber == 0)
 		ThreadNumber = std::thread::hardware_concurrency();
-	GLogger->Log(ELogLevel::kDebug, "IoContext Work Thread Count {:d}", ThreadNumber);
-	for (uint32_t i = 0; i < ThreadNumber; i++) {
-		Impl->IoContextThreads.emplace_back(std::thread([&] {
+	Impl->IoShardBalance = IoShardBalance;
+	auto RegisterIoContextThread = [this] {
+		TRACE_THREAD_NAME("IoContext");
 #ifndef NDEBUG
-			static std::mutex Mutex;
-			{
-				std::lock_guard<std::mutex> Lock(Mutex);
-				Impl->IoContextThreadIds.push_back(std::this_thread::get_id());
-			}
+		static std::mutex Mutex;
+		{
+			std::lock_guard<std::mutex> Lock(Mutex);
+			Impl->IoContextThreadIds.push_back(std::this_thread::get_id());
+		}
 #endif // NDEBUG
+	};
+	if (IoContextMode == EIoContextMode::Sharded)
+	{
+		// shared io context only run acceptor and resolver, connections live in the shards
+		LOG_CATEGORY(LogNetwork, ELogLevel::kDebug, "IoContext Shard Count {:d}", ThreadNumber);
+		for (uint32_t i = 0; i < ThreadNumber; i++) {
+			Impl->IoShards.emplace_back(std::make_unique<FImpl::FIoShard>());
+			FImpl::FIoShard* IoShard = Impl->IoShards.back().get();
+			IoShard->Thread = std::thread([this, IoShard, RegisterIoContextThread] {
+				RegisterIoContextThread();
+				IoShard->IoContext.run();
+				});
+		}
+		ThreadNumber = 1;
+	}
+	LOG_CATEGORY(LogNetwork, ELogLevel::kDebug, "IoContext Work Thread Count {:d}", ThreadNumber);
+	for (uint32_t i = 0; i < ThreadNumber; i++) {
+		Impl->IoContextThreads.emplace_back(std::thread([this, RegisterIoContextThread] {
+			RegisterIoContextThread();
 			Impl->IoContext.run();
 			}));
 	}
@@ -174,23 +226,118 @@ IConnectionOwner::~IConnectionOwner()
 		std::this_thread::yield();
 	}
 	Impl->IdleWorkerPtr.reset();
-	for (uint32_t i = 0; i < Impl->IoContextThreadIds.size(); i++)
+	for (uint32_t i = 0; i < Impl->IoContextThreads.size(); i++)
 	{
 		if (Impl->IoContextThreads[i].joinable())
 			Impl->IoContextThreads[i].join();
 	}
+	for (auto& IoShard : Impl->IoShards)
+	{
+		IoShard->IdleWorker.reset();
+		if (IoShard->Thread.joinable())
+			IoShard->Thread.join();
+	}
 }
 
 asio::io_context& IConnectionOwner::GetIoContext() { return Impl->IoContext; }
 
-TQueue<FMessage, EQueueMode::MPSC>& IConnectionOwner::GetRecvQueue() { return Impl->RecvFrom; }
+asio::io_context& IConnectionOwner::AcquireIoContext(uint32_t& OutIoShard)
+{
+	if (Impl->IoShards.empty())
+	{
+		OutIoShard = UINT32_MAX;
+		return Impl->IoContext;
+	}
+	uint32_t NumIoShards = static_cast<uint32_t>(Impl->IoShards.size());
+	if (Impl->IoShardBalance == EIoShardBalance::LeastConnections)
+	{
+		OutIoShard = 0;
+		uint32_t LeastConnections = UINT32_MAX;
+		// start from a rotating shard so ties spread out
+		uint32_t Start = Impl->NextIoShard++;
+		for (uint32_t i = 0; i < NumIoShards; i++)
+		{
+			uint32_t Index = (Start + i) % NumIoShards;
+			uint32_t Connections = Impl->IoShards[Index]->ConnectionCounter.load(std::memory_order_relaxed);
+			if (Connections < LeastConnections)
+			{
+				LeastConnections = Connections;
+				OutIoShard = Index;
+			}
+		}
+	}
+	else
+	{
+		OutIoShard = Impl->NextIoShard++ % NumIoShards;
+	}
+	Impl->IoShards[OutIoShard]->ConnectionCounter++;
+	return Impl->IoShards[OutIoShard]->IoContext;
+}
+
+void IConnectionOwner::ReleaseIoContext(uint32_t IoShard)
+{
+	if (IoShard != UINT32_MAX)
+		Impl->IoShards[IoShard]->ConnectionCounter--;
+}
+
+bool IConnectionOwner::IsSharded() { return !Impl->IoShards.empty(); }
+
+FRecvQueue& IConnectionOwner::GetRecvQueue() { return Impl->RecvFrom; }
 
 void IConnectionOwner::IncreaseConnectionCounter() {
-	GLogger->Log(ELogLevel::kDebug, "Current Live Connection Count {:d}", ++(Impl->ConnectionCounter));
+	uint32_t ConnectionCounter = ++(Impl->ConnectionCounter);
+	LOG_CATEGORY(LogNetwork, ELogLevel::kDebug, "Current Live Connection Count {:d}", ConnectionCounter);
 }
 
 void IConnectionOwner::DecreaseConnectionCounter() {
-	GLogger->Log(ELogLevel::kDebug, "Current Live Connection Count {:d}", --(Impl->ConnectionCounter));
+	uint32_t ConnectionCounter = --(Impl->ConnectionCounter);
+	LOG_CATEGORY(LogNetwork, ELogLevel::kDebug, "Current Live Connection Count {:d}", ConnectionCounter);
+}
+
+void IConnectionOwner::AddClosedConnectionStats(const FConnectionStats& Stats)
+{
+	std::lock_guard<std::mutex> Lock(Impl->ClosedStatsMutex);
+	Impl->ClosedRead.OperationCounter += Stats.Read.OperationCounter;
+	Impl->ClosedRead.MessageCounter += Stats.Read.MessageCounter;
+	Impl->ClosedRead.ByteCounter += Stats.Read.ByteCounter;
+	Impl->ClosedWrite.OperationCounter += Stats.Write.OperationCounter;
+	Impl->ClosedWrite.MessageCounter += Stats.Write.MessageCounter;
+	Impl->ClosedWrite.ByteCounter += Stats.Write.ByteCounter;
+	Impl->ClosedDroppedMessages += Stats.DroppedMessages;
+}
+
+FConnectionOwnerStats IConnectionOwner::GetStats()
+{
+	assert(Impl->RunInOwnerThread());
+	FConnectionOwnerStats Stats{};
+	Stats.ConnectionCount = Impl->ConnectionCounter.load(std::memory_order_relaxed);
+	{
+		std::lock_guard<std::mutex> Lock(Impl->ClosedStatsMutex);
+		Stats.Read = Impl->ClosedRead;
+		Stats.Write = Impl->ClosedWrite;
+		Stats.DroppedMessages = Impl->ClosedDroppedMessages;
+	}
+	auto AddConnection = [&Stats](const std::shared_ptr<SConnection>& Connection) {
+		FConnectionStats ConnectionStats = Connection->GetStats();
+		Stats.Read.OperationCounter += ConnectionStats.Read.OperationCounter;
+		Stats.Read.MessageCounter += ConnectionStats.Read.MessageCounter;
+		Stats.Read.ByteCounter += ConnectionStats.Read.ByteCounter;
+		Stats.Write.OperationCounter += ConnectionStats.Write.OperationCounter;
+		Stats.Write.MessageCounter += ConnectionStats.Write.MessageCounter;
+		Stats.Write.ByteCounter += ConnectionStats.Write.ByteCounter;
+		Stats.SendQueueMessages += ConnectionStats.SendQueueMessages;
+		Stats.SendQueueBytes += ConnectionStats.SendQueueBytes;
+		Stats.MaxSendQueueMessages = (std::max)(Stats.MaxSendQueueMessages, ConnectionStats.MaxSendQueueMessages);
+		Stats.MaxSendQueueBytes = (std::max)(Stats.MaxSendQueueBytes, ConnectionStats.MaxSendQueueBytes);
+		Stats.DroppedMessages += ConnectionStats.DroppedMessages;
+		Stats.Connections.emplace_back(Connection->GetNetworkName(), ConnectionStats);
+	};
+	Stats.Connections.reserve(Impl->ConnectionMap.size() + Impl->WaitCleanConnections.size());
+	for (auto& Connection : Impl->ConnectionMap)
+		AddConnection(Connection.second);
+	for (auto& Connection : Impl->WaitCleanConnections)
+		AddConnection(Connection);
+	return Stats;
 }
 
 void IConnectionOwner::PushTask(std::function<void()>&& Task) { Impl->Tasks.Enqueue(std::move(Task)); }
@@ -198,18 +345,51 @@ void IConnectionOwner::PushTask(std::function<void()>&& Task) { Impl->Tasks.Enqu
 void IConnectionOwner::ProcessTask()
 {
 	std::function<void()> Task;
-	while (Impl->Tasks.Dequeue(Task))
+	if (!Impl->Tasks.Dequeue(Task))
+		return;
+	TRACE_SCOPE("IConnectionOwner::ProcessTask", "Network");
+	do
 		Task();
+	while (Impl->Tasks.Dequeue(Task));
 }
 
 uint32_t IConnectionOwner::ProcessMessage()
 {
 	FMessage Message;
 	uint32_t ProcessMessageCounter = 0;
-	while (Impl->RecvFrom.Dequeue(Message)){
+	if (!Impl->RecvFrom.Dequeue(Message))
+		return 0;
+	TRACE_SCOPE("IConnectionOwner::ProcessMessage", "Network");
+	do {
 		ProcessMessageCounter++;
+		LOG_SCOPE_TIME("IConnectionOwner::OnMessage");
 		OnMessage(Message.MessageOwner, Message.MessageData);
-	}
+	} while (Impl->RecvFrom.Dequeue(Message));
+	return ProcessMessageCounter;
+}
+
+uint32_t IConnectionOwner::ProcessMessage(uint32_t MaxBatch)
+{
+	assert(Impl->RunInOwnerThread());
+	assert(MaxBatch > 0);
+	std::vector<FMessage>& MessageBatch = Impl->MessageBatch;
+	if (MessageBatch.size() < MaxBatch)
+		MessageBatch.resize(MaxBatch);
+#ifdef RECV_FROM_USE_RING_QUEUE
+	uint32_t ProcessMessageCounter = Impl->RecvFrom.DequeueBulk(MessageBatch.begin(), MaxBatch);
+#else
+	uint32_t ProcessMessageCounter = 0;
+	while (ProcessMessageCounter < MaxBatch && Impl->RecvFrom.Dequeue(MessageBatch[ProcessMessageCounter]))
+		ProcessMessageCounter++;
+#endif // RECV_FROM_USE_RING_QUEUE
+	if (ProcessMessageCounter == 0)
+		return 0;
+	TRACE_SCOPE("IConnectionOwner::ProcessMessage", "Network");
+	LOG_SCOPE_TIME("IConnectionOwner::ProcessMessage");
+	OnMessageBatch(std::span<FMessage>(MessageBatch.data(), ProcessMessageCounter));
+	// don't keep connections alive through the buffer, message data is overwritten by the next batch
+	for (uint32_t i = 0; i < ProcessMessageCounter; i++)
+		MessageBatch[i].MessageOwner.reset();
 	return ProcessMessageCounter;
 }
 
@@ -222,6 +402,8 @@ uint32_t IConnectionOwner::ProcessEvent()
 
 void IConnectionOwner::OnMessage(std::shared_ptr<SConnection> ConnectionPtr, FMessageData& MessageData)
 {
+	if (!LogNetwork.IsEnabled(ELogLevel::kInfo))
+		return;
 	std::string BinaryString = std::format("<{:s}> Recv : ", ConnectionPtr->GetNetworkName());
 	BinaryString.reserve(BinaryString.size() + MessageData.GetBodySize() * 4);
 	for (size_t i = 0; i < MessageData.GetBodySize(); i++)
@@ -232,12 +414,21 @@ void IConnectionOwner::OnMessage(std::shared_ptr<SConnection> ConnectionPtr, FMe
 	GLogger->Log(ELogLevel::kInfo, BinaryString);
 }
 
+void IConnectionOwner::OnMessageBatch(std::span<FMessage> Messages)
+{
+	for (FMessage& Message : Messages)
+	{
+		LOG_SCOPE_TIME("IConnectionOwner::OnMessage");
+		OnMessage(Message.MessageOwner, Message.MessageData);
+	}
+}
+
 void IConnectionOwner::OnConnectionConnected(std::shared_ptr<SConnection> ConnectionPtr)
 {
 	assert(Impl->RunInOwnerThread());
 	auto ExistConnection = Impl->ConnectionMap.find(ConnectionPtr->GetNetworkName());
 	if (ExistConnection != std::end(Impl->ConnectionMap)) {
-		GLogger->Log(ELogLevel::kWarning, "Existed Connection<{:s}>", ConnectionPtr->GetNetworkName());
+		LOG_CATEGORY(LogNetwork, ELogLevel::kWarning, "Existed Connection<{:s}>", ConnectionPtr->GetNetworkName());
 		ExistConnection->second->Disconnect();
 		Impl->WaitCleanConnections.push_back(ExistConnection->second);
 		ExistConnection->second = ConnectionPtr;
@@ -246,8 +437,9 @@ void IConnectionOwner::OnConnectionConnected(std::shared_ptr<SConnection> Connec
 	{
 		Impl->ConnectionMap.insert(std::make_pair<>(ConnectionPtr->GetNetworkName(), ConnectionPtr));
 	}
-	GLogger->Log(ELogLevel::kInfo, "Connection<{}> Connected", ConnectionPtr->GetNetworkName());
-	GLogger->Log(ELogLevel::kDebug, "Current Connected Connection Count {:d}", ++(Impl->ConnectedConnection));
+	LOG_CATEGORY(LogNetwork, ELogLevel::kInfo, "Connection<{}> Connected", ConnectionPtr->GetNetworkName());
+	++(Impl->ConnectedConnection);
+	LOG_CATEGORY(LogNetwork, ELogLevel::kDebug, "Current Connected Connection Count {:d}", Impl->ConnectedConnection);
 }
 
 void IConnectionOwner::OnConnectionDisconnected(std::shared_ptr<SConnection> ConnectionPtr)
@@ -263,8 +455,15 @@ void IConnectionOwner::OnConnectionDisconnected(std::shared_ptr<SConnection> Con
 	}
 	assert(Impl->ConnectionMap.erase(ConnectionPtr->GetNetworkName()) == 1);
 PrintToLogger:
-	GLogger->Log(ELogLevel::kInfo, "Connection<{}> Disconnected", ConnectionPtr->GetNetworkName());
-	GLogger->Log(ELogLevel::kDebug, "Current Connected Connection Count {:d} ", --(Impl->ConnectedConnection));
+	LOG_CATEGORY(LogNetwork, ELogLevel::kInfo, "Connection<{}> Disconnected", ConnectionPtr->GetNetworkName());
+	--(Impl->ConnectedConnection);
+	LOG_CATEGORY(LogNetwork, ELogLevel::kDebug, "Current Connected Connection Count {:d} ", Impl->ConnectedConnection);
+}
+
+void IConnectionOwner::OnConnectionWritable(std::shared_ptr<SConnection> ConnectionPtr)
+{
+	assert(Impl->RunInOwnerThread());
+	LOG_CATEGORY(LogNetwork, ELogLevel::kDebug, "Connection<{}> Writable", ConnectionPtr->GetNetworkName());
 }
 
 std::unordered_map<std::string, std::shared_ptr<SConnection>>& IConnectionOwner::GetConnectionMap()
@@ -273,6 +472,28 @@ std::unordered_map<std::string, std::shared_ptr<SConnection>>& IConnectionOwner:
 	return Impl->ConnectionMap;
 }
 
+uint32_t IConnectionOwner::Broadcast(const FMessageData& MessageData, const std::function<bool(const std::shared_ptr<SConnection>&)>& Filter)
+{
+	return Broadcast(FMessageData(MessageData), Filter);
+}
+
+uint32_t IConnectionOwner::Broadcast(FMessageData&& MessageData, const std::function<bool(const std::shared_ptr<SConnection>&)>& Filter)
+{
+	assert(Impl->RunInOwnerThread());
+	std::shared_ptr<FMessageData> SharedMessageData = std::make_shared<FMessageData>(std::move(MessageData));
+	// materialize the header before io threads read it
+	SharedMessageData->GetHeader();
+	uint32_t BroadcastCounter = 0;
+	for (auto& Connection : Impl->ConnectionMap)
+	{
+		if (Filter && !Filter(Connection.second))
+			continue;
+		Connection.second->Send(SharedMessageData);
+		BroadcastCounter++;
+	}
+	return BroadcastCounter;
+}
+
 bool IConnectionOwner::RunInOwnerThread()
 {
 	return Impl->RunInOwnerThread();
@@ -283,8 +504,8 @@ bool IConnectionOwner::RunInIoContext()
 	return Impl->RunInIoContext();
 }
 
-CClient::CClient(uint32_t ThreadNumber)
-	: IConnectionOwner(ThreadNumber)
+CClient::CClient(uint32_t ThreadNumber, EIoContextMode IoContextMode, EIoShardBalance IoShardBalance)
+	: IConnectionOwner(ThreadNumber, IoContextMode, IoShardBalance)
 {
 }
 
@@ -315,14 +536,14 @@ std::future<std::shared_ptr<SConnection>> CClient::ConnectToServer(std::string A
 	}
 	catch (const std::exception& Exception)
 	{
-		GLogger->Log(ELogLevel::kWarning, "Exception: {}\n", Exception.what());
+		LOG_CATEGORY(LogNetwork, ELogLevel::kWarning, "Exception: {}\n", Exception.what());
 		Promise.set_value(std::shared_ptr<SConnection>());
 	}
 	return std::move(ConnectionFuture);
 }
 
-CServer::CServer(uint32_t ThreadNumber)
-	: IConnectionOwner(ThreadNumber)
+CServer::CServer(uint32_t ThreadNumber, EIoContextMode IoContextMode, EIoShardBalance IoShardBalance)
+	: IConnectionOwner(ThreadNumber, IoContextMode, IoShardBalance)
 {
 }
 
@@ -330,33 +551,69 @@ CServer::~CServer() {
 	Stop();
 }
 
-void CServer::Run(uint16_t Port)
+void CServer::Run(uint16_t Port, uint32_t NumAcceptors, uint32_t NumPendingAccepts)
 {
 	if (!CheckRunCallOnce()) return;
-	GLogger->Log(ELogLevel::kInfo, "Server Run");
+	LOG_CATEGORY(LogNetwork, ELogLevel::kInfo, "Server Run");
+	assert(NumPendingAccepts > 0);
+	PendingAcceptsPerAcceptor = NumPendingAccepts;
+	if (NumAcceptors == 0)
+		NumAcceptors = static_cast<uint32_t>(IsSharded() ? Impl->IoShards.size() : Impl->IoContextThreads.size());
+#ifndef SO_REUSEPORT
+	if (NumAcceptors > 1)
+	{
+		LOG_CATEGORY(LogNetwork, ELogLevel::kWarning, "SO_REUSEPORT not supported, use one acceptor with {:d} pending accepts", NumAcceptors * NumPendingAccepts);
+		PendingAcceptsPerAcceptor = NumAcceptors * NumPendingAccepts;
+		NumAcceptors = 1;
+	}
+#endif // SO_REUSEPORT
 	auto Endpoint = asio::ip::tcp::endpoint(asio::ip::tcp::v4(), Port);
-	Impl->Acceptor.open(Endpoint.protocol());
-	Impl->Acceptor.set_option(asio::ip::tcp::acceptor::reuse_address(true));
-	Impl->Acceptor.bind(Endpoint);
-	Impl->Acceptor.listen();
+	for (uint32_t i = 0; i < NumAcceptors; i++)
+	{
+		// in sharded mode every shard run its own acceptor
+		asio::io_context& AcceptorIoContext = IsSharded() ? Impl->IoShards[i % Impl->IoShards.size()]->IoContext : Impl->IoContext;
+		auto Acceptor = std::make_unique<asio::ip::tcp::acceptor>(AcceptorIoContext);
+		Acceptor->open(Endpoint.protocol());
+		Acceptor->set_option(asio::ip::tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+		if (NumAcceptors > 1)
+			Acceptor->set_option(asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>(true));
+#endif // SO_REUSEPORT
+		Acceptor->bind(Endpoint);
+		Acceptor->listen(asio::socket_base::max_listen_connections);
+		Impl->Acceptors.push_back(std::move(Acceptor));
+	}
 	WaitForClientConnection();
 }
 
 void CServer::WaitForClientConnection()
 {
-	Impl->Acceptor.async_accept(
-		[this](std::error_code ErrorCode, asio::ip::tcp::socket Socket)
+	for (uint32_t i = 0; i < Impl->Acceptors.size(); i++)
+	{
+		for (uint32_t j = 0; j < PendingAcceptsPerAcceptor; j++)
+			WaitForClientConnection(i);
+	}
+}
+
+void CServer::WaitForClientConnection(uint32_t AcceptorIndex)
+{
+	// create the connection first, so the socket is accepted straight into the io context (shard) of the connection
+	std::shared_ptr<SConnection> NewConnection = std::make_shared<SConnection>(*this, nullptr);
+	Impl->Acceptors[AcceptorIndex]->async_accept(*(asio::ip::tcp::socket*)NewConnection->GetSocket(),
+		[this, NewConnection, AcceptorIndex](std::error_code ErrorCode) mutable
 		{
+			// the acceptor may run on another shard, the connection is started and released on its own io context
+			auto Executor = ((asio::ip::tcp::socket*)NewConnection->GetSocket())->get_executor();
 			if (!ErrorCode)
 			{
-				std::shared_ptr<SConnection> NewConnection = std::make_shared<SConnection>(*this, nullptr);
-				*(asio::ip::tcp::socket*)NewConnection->GetSocket() = std::move(Socket);
-				NewConnection->ConnectToClient();
-				WaitForClientConnection();
+				asio::dispatch(Executor, [Connection = std::move(NewConnection)] { Connection->ConnectToClient(); });
+				WaitForClientConnection(AcceptorIndex);
 			}
 			else
 			{
-				GLogger->Log(ELogLevel::kWarning, "Accept Connection Error: ", ErrorCode.message());
+				if (ErrorCode != asio::error::operation_aborted)
+					LOG_CATEGORY(LogNetwork, ELogLevel::kWarning, "Accept Connection Error: {:s}", ErrorCode.message());
+				asio::post(Executor, [Connection = std::move(NewConnection)] {});
 			}
 		}
 	);
@@ -364,8 +621,19 @@ void CServer::WaitForClientConnection()
 
 void CServer::Stop()
 {
-	Impl->Acceptor.close();
-	GLogger->Log(ELogLevel::kInfo, "Server Stop");
+	for (auto& Acceptor : Impl->Acceptors)
+	{
+		// acceptor is not thread safe, close it on its own io context
+		std::promise<void> Promise;
+		std::future<void> Future = Promise.get_future();
+		asio::dispatch(Acceptor->get_executor(), [&] {
+			std::error_code ErrorCode;
+			Acceptor->close(ErrorCode);
+			Promise.set_value();
+			});
+		Future.get();
+	}
+	LOG_CATEGORY(LogNetwork, ELogLevel::kInfo, "Server Stop");
 }
 
 bool CServer::CheckRunCallOnce()
@@ -373,7 +641,7 @@ bool CServer::CheckRunCallOnce()
 #ifndef NDEBUG
 	if (RunCallOnceFlag)
 	{
-		GLogger->Log(ELogLevel::kInfo, "CServer::Run just call once, please renew a CServer");
+		LOG_CATEGORY(LogNetwork, ELogLevel::kInfo, "CServer::Run just call once, please renew a CServer");
 		return false;
 	}
 	RunCallOnceFlag = true;
@@ -0,0 +1,195 @@
+#include "LogFileSink.h"
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include "Core.h"
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif // _WIN32
+
+struct CLogFileSink::FImpl
+{
+	FImpl(const FLogFileSinkConfig& InConfig)
+		: Config(InConfig)
+	{
+		// at least room for the file header and one record
+		if (Config.SegmentSize < 4096)
+			Config.SegmentSize = 4096;
+	}
+
+	bool Map(const std::string& Path)
+	{
+#ifdef _WIN32
+		File = CreateFileA(Path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (File == INVALID_HANDLE_VALUE)
+			return false;
+		Mapping = CreateFileMappingA(File, nullptr, PAGE_READWRITE, DWORD(Config.SegmentSize >> 32), DWORD(Config.SegmentSize), nullptr);
+		if (Mapping == nullptr)
+		{
+			CloseHandle(File);
+			File = INVALID_HANDLE_VALUE;
+			return false;
+		}
+		Data = static_cast<uint8_t*>(MapViewOfFile(Mapping, FILE_MAP_WRITE, 0, 0, SIZE_T(Config.SegmentSize)));
+		if (Data == nullptr)
+		{
+			CloseHandle(Mapping);
+			CloseHandle(File);
+			Mapping = nullptr;
+			File = INVALID_HANDLE_VALUE;
+			return false;
+		}
+#else
+		File = open(Path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+		if (File < 0)
+			return false;
+		if (ftruncate(File, off_t(Config.SegmentSize)) != 0)
+		{
+			close(File);
+			File = -1;
+			return false;
+		}
+		void* Address = mmap(nullptr, size_t(Config.SegmentSize), PROT_READ | PROT_WRITE, MAP_SHARED, File, 0);
+		if (Address == MAP_FAILED)
+		{
+			close(File);
+			File = -1;
+			return false;
+		}
+		Data = static_cast<uint8_t*>(Address);
+#endif // _WIN32
+		return true;
+	}
+
+	// unmap and cut the file to the written size
+	void Unmap()
+	{
+		if (Data == nullptr)
+			return;
+#ifdef _WIN32
+		UnmapViewOfFile(Data);
+		CloseHandle(Mapping);
+		LARGE_INTEGER Size;
+		Size.QuadPart = LONGLONG(Offset);
+		SetFilePointerEx(File, Size, nullptr, FILE_BEGIN);
+		SetEndOfFile(File);
+		CloseHandle(File);
+		Mapping = nullptr;
+		File = INVALID_HANDLE_VALUE;
+#else
+		munmap(Data, size_t(Config.SegmentSize));
+		[[maybe_unused]] int Result = ftruncate(File, off_t(Offset));
+		close(File);
+		File = -1;
+#endif // _WIN32
+		Data = nullptr;
+	}
+
+	FLogFileSinkConfig Config;
+#ifdef _WIN32
+	HANDLE File{ INVALID_HANDLE_VALUE };
+	HANDLE Mapping{ nullptr };
+#else
+	int File{ -1 };
+#endif // _WIN32
+	uint8_t* Data{ nullptr };
+	uint64_t Offset{ 0 };
+	int64_t SegmentCreateTime{ 0 };
+	uint32_t SegmentIndex{ 0 };
+	std::string SegmentPath;
+	// do not retry opening on every record after a failure
+	int64_t NextOpenTime{ 0 };
+};
+
+CLogFileSink::CLogFileSink(const FLogFileSinkConfig& Config)
+	: Impl(std::make_unique<FImpl>(Config))
+{
+}
+
+CLogFileSink::~CLogFileSink()
+{
+	CloseSegment();
+}
+
+void CLogFileSink::Write(const FLogRecordHeader& Record, std::string_view Message)
+{
+	int64_t Timestamp = Record.Timestamp;
+	uint64_t MaxMessageSize = Impl->Config.SegmentSize - sizeof(FLogFileHeader) - sizeof(FLogFileRecord);
+	if (Message.size() > MaxMessageSize)
+		Message = Message.substr(0, size_t(MaxMessageSize));
+	uint32_t RecordSize = uint32_t((sizeof(FLogFileRecord) + Message.size() + 7) & ~uint64_t(7));
+
+	bool Rotate = Impl->Data == nullptr || Impl->Offset + RecordSize > Impl->Config.SegmentSize;
+	if (!Rotate && Impl->Config.RotationSeconds != 0)
+		Rotate = Timestamp - Impl->SegmentCreateTime >= int64_t(Impl->Config.RotationSeconds) * 1000000000;
+	if (Rotate)
+	{
+		CloseSegment();
+		if (Timestamp < Impl->NextOpenTime || !OpenSegment(Timestamp))
+			return;
+	}
+
+	FLogFileRecord FileRecord{};
+	FileRecord.RecordSize = RecordSize;
+	FileRecord.LogLevel = uint32_t(Record.LogLevel);
+	FileRecord.Timestamp = Timestamp;
+	memcpy(&FileRecord.ThreadId, &Record.ThreadId, (std::min)(sizeof(FileRecord.ThreadId), sizeof(Record.ThreadId)));
+	FileRecord.MessageSize = uint32_t(Message.size());
+	uint8_t* Destination = Impl->Data + Impl->Offset;
+	memcpy(Destination, &FileRecord, sizeof(FileRecord));
+	memcpy(Destination + sizeof(FileRecord), Message.data(), Message.size());
+	// the padding is already zero, a fresh segment is zero filled
+	Impl->Offset += RecordSize;
+}
+
+void CLogFileSink::Flush()
+{
+	// mapped pages are written back by the system, they survive a crash of the process
+}
+
+std::string CLogFileSink::GetSegmentPath() const
+{
+	return Impl->SegmentPath;
+}
+
+bool CLogFileSink::OpenSegment(int64_t Timestamp)
+{
+	time_t Seconds = time_t(Timestamp / 1000000000);
+	tm SegmentTm{};
+#ifdef _WIN32
+	localtime_s(&SegmentTm, &Seconds);
+#else
+	localtime_r(&Seconds, &SegmentTm);
+#endif // _WIN32
+	char TimeString[32];
+	std::strftime(TimeString, sizeof(TimeString), "%Y%m%d-%H%M%S", &SegmentTm);
+
+	std::error_code ErrorCode;
+	std::filesystem::create_directories(Impl->Config.Directory, ErrorCode);
+	std::filesystem::path Path = std::filesystem::path(Impl->Config.Directory) /
+		std::format("{:s}-{:s}-{:04d}{:s}", Impl->Config.BaseName, TimeString, Impl->SegmentIndex++, LOG_FILE_EXTENSION);
+	if (!Impl->Map(Path.string()))
+	{
+		// retry after one second
+		Impl->NextOpenTime = Timestamp + 1000000000;
+		Impl->SegmentPath.clear();
+		GLogger->Log(ELogLevel::kError, "{:s}", "Open log segment failed: " + Path.string());
+		return false;
+	}
+	FLogFileHeader FileHeader{ LOG_FILE_MAGIC, LOG_FILE_VERSION, Timestamp };
+	memcpy(Impl->Data, &FileHeader, sizeof(FileHeader));
+	Impl->Offset = sizeof(FileHeader);
+	Impl->SegmentCreateTime = Timestamp;
+	Impl->SegmentPath = Path.string();
+	return true;
+}
+
+void CLogFileSink::CloseSegment()
+{
+	Impl->Unmap();
+	Impl->Offset = 0;
+}
@@ -0,0 +1,254 @@
+#include "LogScopeTime.h"
+#include <algorithm>
+#include <cstring>
+#include <format>
+#include <memory>
+#include <mutex>
+
+namespace
+{
+	struct FLogScopeTimeThread
+	{
+		~FLogScopeTimeThread()
+		{
+			for (auto& Histogram : Histograms)
+				delete Histogram.load(std::memory_order_relaxed);
+		}
+
+		// published with release by the owner thread on first record of a site
+		std::atomic<FLogScopeTimeHistogram*> Histograms[LOG_SCOPE_TIME_MAX_SITES]{};
+		// set when the owner thread exit, the histograms are folded into the retired ones
+		std::atomic<bool> Closed{ false };
+	};
+
+	// histogram without concurrent writers
+	struct FLogScopeTimeMerged
+	{
+		uint64_t Count{ 0 };
+		uint64_t Total{ 0 };
+		uint64_t Max{ 0 };
+		uint64_t Buckets[FLogScopeTimeHistogram::kBucketCount]{};
+
+		void Merge(const FLogScopeTimeHistogram& Histogram)
+		{
+			Count += Histogram.Count.load(std::memory_order_relaxed);
+			Total += Histogram.Total.load(std::memory_order_relaxed);
+			Max = (std::max)(Max, Histogram.Max.load(std::memory_order_relaxed));
+			for (uint32_t i = 0; i < FLogScopeTimeHistogram::kBucketCount; i++)
+				Buckets[i] += Histogram.Buckets[i].load(std::memory_order_relaxed);
+		}
+
+		void Merge(const FLogScopeTimeMerged& Other)
+		{
+			Count += Other.Count;
+			Total += Other.Total;
+			Max = (std::max)(Max, Other.Max);
+			for (uint32_t i = 0; i < FLogScopeTimeHistogram::kBucketCount; i++)
+				Buckets[i] += Other.Buckets[i];
+		}
+
+		uint64_t GetPercentile(double Percentile) const
+		{
+			if (Count == 0)
+				return 0;
+			uint64_t Rank = (std::max)(uint64_t(1), uint64_t(Percentile * double(Count) + 0.5));
+			uint64_t Accumulated = 0;
+			for (uint32_t i = 0; i < FLogScopeTimeHistogram::kBucketCount; i++)
+			{
+				Accumulated += Buckets[i];
+				if (Accumulated >= Rank)
+					return (std::min)(FLogScopeTimeHistogram::GetBucketValue(i), Max);
+			}
+			return Max;
+		}
+	};
+
+	struct FLogScopeTimeRegistry
+	{
+		std::mutex Mutex;
+		std::vector<const FLogScopeTimeSite*> Sites;
+		std::vector<std::shared_ptr<FLogScopeTimeThread>> Threads;
+		// records of exited threads, indexed by site
+		std::vector<std::unique_ptr<FLogScopeTimeMerged>> Retired;
+	};
+
+	// sites are static locals of other translation units
+	FLogScopeTimeRegistry& GetLogScopeTimeRegistry()
+	{
+		static FLogScopeTimeRegistry* LogScopeTimeRegistry = new FLogScopeTimeRegistry();
+		return *LogScopeTimeRegistry;
+	}
+
+	struct FLogScopeTimeThreadHolder
+	{
+		~FLogScopeTimeThreadHolder()
+		{
+			if (Thread)
+				Thread->Closed.store(true, std::memory_order_release);
+		}
+		std::shared_ptr<FLogScopeTimeThread> Thread;
+	};
+
+	thread_local FLogScopeTimeThreadHolder GLogScopeTimeThreadHolder;
+
+	FLogScopeTimeThread& GetLogScopeTimeThread()
+	{
+		if (!GLogScopeTimeThreadHolder.Thread)
+		{
+			GLogScopeTimeThreadHolder.Thread = std::make_shared<FLogScopeTimeThread>();
+			FLogScopeTimeRegistry& Registry = GetLogScopeTimeRegistry();
+			std::lock_guard<std::mutex> Lock(Registry.Mutex);
+			Registry.Threads.push_back(GLogScopeTimeThreadHolder.Thread);
+		}
+		return *GLogScopeTimeThreadHolder.Thread;
+	}
+
+	// caller hold the registry lock
+	std::vector<FLogScopeTimeMerged> MergeHistograms(FLogScopeTimeRegistry& Registry)
+	{
+		size_t SiteCount = Registry.Sites.size();
+		if (Registry.Retired.size() < SiteCount)
+			Registry.Retired.resize(SiteCount);
+		std::vector<FLogScopeTimeMerged> Merged(SiteCount);
+		for (auto It = Registry.Threads.begin(); It != Registry.Threads.end();)
+		{
+			FLogScopeTimeThread& Thread = **It;
+			// read before merge, the owner thread does not record after closing
+			bool Closed = Thread.Closed.load(std::memory_order_acquire);
+			for (size_t i = 0; i < SiteCount; i++)
+			{
+				FLogScopeTimeHistogram* Histogram = Thread.Histograms[i].load(std::memory_order_acquire);
+				if (Histogram == nullptr)
+					continue;
+				if (Closed)
+				{
+					if (!Registry.Retired[i])
+						Registry.Retired[i] = std::make_unique<FLogScopeTimeMerged>();
+					Registry.Retired[i]->Merge(*Histogram);
+				}
+				else
+				{
+					Merged[i].Merge(*Histogram);
+				}
+			}
+			if (Closed)
+				It = Registry.Threads.erase(It);
+			else
+				It++;
+		}
+		for (size_t i = 0; i < SiteCount; i++)
+		{
+			if (Registry.Retired[i])
+				Merged[i].Merge(*Registry.Retired[i]);
+		}
+		return Merged;
+	}
+
+	void AppendBinary(std::vector<uint8_t>& Out, const void* Data, size_t Size)
+	{
+		const uint8_t* Bytes = static_cast<const uint8_t*>(Data);
+		Out.insert(Out.end(), Bytes, Bytes + Size);
+	}
+
+	template<typename T>
+	void AppendBinary(std::vector<uint8_t>& Out, const T& Value)
+	{
+		AppendBinary(Out, &Value, sizeof(T));
+	}
+
+	void AppendBinaryString(std::vector<uint8_t>& Out, const char* String)
+	{
+		uint32_t Size = uint32_t(strlen(String));
+		AppendBinary(Out, Size);
+		AppendBinary(Out, String, Size);
+	}
+}
+
+FLogScopeTimeSite::FLogScopeTimeSite(const char* Name, const char* File, uint32_t Line)
+	: Name(Name)
+	, File(File)
+	, Line(Line)
+	, Index(UINT32_MAX)
+{
+	FLogScopeTimeRegistry& Registry = GetLogScopeTimeRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	if (Registry.Sites.size() < LOG_SCOPE_TIME_MAX_SITES)
+	{
+		Index = uint32_t(Registry.Sites.size());
+		Registry.Sites.push_back(this);
+	}
+}
+
+void FLogScopeTimeProfiler::Record(const FLogScopeTimeSite& Site, uint64_t Nanoseconds)
+{
+	if (Site.Index == UINT32_MAX)
+		return;
+	FLogScopeTimeThread& Thread = GetLogScopeTimeThread();
+	FLogScopeTimeHistogram* Histogram = Thread.Histograms[Site.Index].load(std::memory_order_relaxed);
+	if (Histogram == nullptr)
+	{
+		Histogram = new FLogScopeTimeHistogram();
+		Thread.Histograms[Site.Index].store(Histogram, std::memory_order_release);
+	}
+	Histogram->Record(Nanoseconds);
+}
+
+std::vector<FLogScopeTimeStat> FLogScopeTimeProfiler::CollectStats()
+{
+	FLogScopeTimeRegistry& Registry = GetLogScopeTimeRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	std::vector<FLogScopeTimeMerged> Merged = MergeHistograms(Registry);
+	std::vector<FLogScopeTimeStat> Stats;
+	for (size_t i = 0; i < Merged.size(); i++)
+	{
+		if (Merged[i].Count == 0)
+			continue;
+		const FLogScopeTimeSite* Site = Registry.Sites[i];
+		Stats.push_back(FLogScopeTimeStat{ Site->Name, Site->File, Site->Line,
+			Merged[i].Count, Merged[i].Total, Merged[i].GetPercentile(0.50), Merged[i].GetPercentile(0.99), Merged[i].Max });
+	}
+	return Stats;
+}
+
+std::string FLogScopeTimeProfiler::DumpText()
+{
+	std::vector<FLogScopeTimeStat> Stats = CollectStats();
+	std::string Text = std::format("{:<40s} {:>12s} {:>12s} {:>12s} {:>12s}\n", "Scope", "Count", "P50(us)", "P99(us)", "Max(us)");
+	for (const FLogScopeTimeStat& Stat : Stats)
+	{
+		std::format_to(std::back_inserter(Text), "{:<40s} {:>12d} {:>12.3f} {:>12.3f} {:>12.3f} {:s}:{:d}\n",
+			Stat.Name, Stat.Count, Stat.P50 / 1000.0, Stat.P99 / 1000.0, Stat.Max / 1000.0, Stat.File, Stat.Line);
+	}
+	return Text;
+}
+
+std::vector<uint8_t> FLogScopeTimeProfiler::DumpBinary()
+{
+	FLogScopeTimeRegistry& Registry = GetLogScopeTimeRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	std::vector<FLogScopeTimeMerged> Merged = MergeHistograms(Registry);
+	std::vector<uint8_t> Out;
+	AppendBinary(Out, uint32_t(LOG_SCOPE_TIME_MAGIC));
+	AppendBinary(Out, uint32_t(LOG_SCOPE_TIME_VERSION));
+	AppendBinary(Out, uint32_t(Merged.size()));
+	for (size_t i = 0; i < Merged.size(); i++)
+	{
+		const FLogScopeTimeSite* Site = Registry.Sites[i];
+		AppendBinaryString(Out, Site->Name);
+		AppendBinaryString(Out, Site->File);
+		AppendBinary(Out, Site->Line);
+		AppendBinary(Out, Merged[i].Count);
+		AppendBinary(Out, Merged[i].Total);
+		AppendBinary(Out, Merged[i].Max);
+		uint32_t BucketCount = uint32_t(std::count_if(std::begin(Merged[i].Buckets), std::end(Merged[i].Buckets), [](uint64_t Bucket) { return Bucket != 0; }));
+		AppendBinary(Out, BucketCount);
+		for (uint32_t j = 0; j < FLogScopeTimeHistogram::kBucketCount; j++)
+		{
+			if (Merged[i].Buckets[j] == 0)
+				continue;
+			AppendBinary(Out, j);
+			AppendBinary(Out, Merged[i].Buckets[j]);
+		}
+	}
+	return Out;
+}
@@ -1,8 +1,11 @@
 #include "Logger.h"
 
 #include <cassert>
+#include <cstring>
 #include <iostream>
+#include <iterator>
 #include "Core.h"
+#include "Trace.h"
 
 CLogger* GLogger = GLogInitializer();
 
@@ -34,87 +37,484 @@ const char* ToString(ELogLevel LogLevel)
 	return "Level";
 }
 
+namespace
+{
+	std::atomic<uint64_t> GLoggerIdCounter{ 0 };
+
+	struct FLogCategoryRegistry
+	{
+		std::mutex Mutex;
+		std::vector<FLogCategory*> Categories;
+	};
+
+	// categories are defined at namespace scope of other translation units
+	FLogCategoryRegistry& GetLogCategoryRegistry()
+	{
+		static FLogCategoryRegistry LogCategoryRegistry;
+		return LogCategoryRegistry;
+	}
+
+	// thread local buffers of the current thread, one per logger instance
+	struct FLogThreadBufferHolder
+	{
+		~FLogThreadBufferHolder()
+		{
+			for (auto& ThreadBuffer : ThreadBuffers)
+				ThreadBuffer.second->Closed.store(true, std::memory_order_release);
+		}
+		std::vector<std::pair<uint64_t, std::shared_ptr<FLogThreadBuffer>>> ThreadBuffers;
+	};
+
+	thread_local FLogThreadBufferHolder GLogThreadBufferHolder;
+
+	// logger drained by the current thread, its own buffer is not drained while it is logging
+	thread_local const CLogger* GDrainingLogger = nullptr;
+
+	constexpr uint32_t kDrainRecordsSize = 256;
+}
+
+namespace
+{
+	int64_t GetSteadyNanoseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	}
+
+	int64_t GetSystemNanoseconds()
+	{
+		return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+	}
+
+	int64_t MeasureLogClockOffset()
+	{
+		// take the tightest of a few steady/system/steady samples
+		int64_t Offset = 0;
+		int64_t MinWindow = INT64_MAX;
+		for (int i = 0; i < 8; i++)
+		{
+			int64_t SteadyBegin = GetSteadyNanoseconds();
+			int64_t System = GetSystemNanoseconds();
+			int64_t SteadyEnd = GetSteadyNanoseconds();
+			if (SteadyEnd - SteadyBegin < MinWindow)
+			{
+				MinWindow = SteadyEnd - SteadyBegin;
+				Offset = System - (SteadyBegin + (SteadyEnd - SteadyBegin) / 2);
+			}
+		}
+		return Offset;
+	}
+}
+
+std::atomic<int64_t>& FLogClock::GetOffset()
+{
+	static std::atomic<int64_t> Offset{ MeasureLogClockOffset() };
+	return Offset;
+}
+
+void FLogClock::Calibrate()
+{
+	GetOffset().store(MeasureLogClockOffset(), std::memory_order_relaxed);
+}
+
+FLogCategory::FLogCategory(const char* Name, uint32_t LevelMask)
+	: Name(Name)
+	, LevelMask(LevelMask)
+{
+	FLogCategoryRegistry& Registry = GetLogCategoryRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	Registry.Categories.push_back(this);
+}
+
+FLogCategory::~FLogCategory()
+{
+	FLogCategoryRegistry& Registry = GetLogCategoryRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	std::erase(Registry.Categories, this);
+}
+
+FLogCategory* FLogCategory::Find(std::string_view Name)
+{
+	FLogCategoryRegistry& Registry = GetLogCategoryRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	for (FLogCategory* Category : Registry.Categories)
+	{
+		if (Name == Category->Name)
+			return Category;
+	}
+	return nullptr;
+}
+
+bool FLogCategory::SetLevelMask(std::string_view Name, uint32_t InLevelMask)
+{
+	FLogCategory* Category = Find(Name);
+	if (!Category)
+		return false;
+	Category->SetLevelMask(InLevelMask);
+	return true;
+}
+
 CLogger::CLogger()
-	: Running(false)
-	, LogThread(&CLogger::Run, this)
+	: Running(true)
+	, LoggerId(GLoggerIdCounter.fetch_add(1, std::memory_order_relaxed))
+	, DrainRecords(std::make_unique<FLogRecord[]>(kDrainRecordsSize))
 {
-	
+	WriteBatch.reserve(LOG_WRITE_BATCH_SIZE);
+	// start after all members are constructed
+	LogThread = std::thread(&CLogger::Run, this);
 }
 
 CLogger::~CLogger()
 {
 	Running = false;
+	WakeUp();
 	LogThread.join();
 }
 
+uint32_t AllocateLogFormatId()
+{
+	static std::atomic<uint32_t> LogFormatIdCounter{ 0 };
+	return LogFormatIdCounter.fetch_add(1, std::memory_order_relaxed);
+}
+
+void CLogger::InitializeRecord(FLogRecord& Record, ELogLevel LogLevel)
+{
+	Record.Timestamp = FLogClock::Now();
+	Record.ThreadId = std::this_thread::get_id();
+	Record.LogLevel = LogLevel;
+	Record.MessageSize = 0;
+	Record.LongMessage = nullptr;
+	Record.Format = nullptr;
+}
+
 void CLogger::Log(ELogLevel LogLevel, const std::string& Message)
 {
-	//assert(Running == true);
-	LogMessageQueue.Enqueue(FLogMessage{
-		std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()),
-		std::this_thread::get_id(),
-		LogLevel,
-		Message.data()
-		});
+	if (!IsEnabled(LogLevel))
+		return;
+	FLogRecord Record;
+	InitializeRecord(Record, LogLevel);
+	Record.MessageSize = uint32_t(Message.size());
+	if (Message.size() <= sizeof(Record.Message))
+	{
+		memcpy(Record.Message, Message.data(), Message.size());
+	}
+	else
+	{
+		Record.LongMessage = new std::string(Message);
+	}
+	PushRecord(Record);
 }
 
 void CLogger::Log(ELogLevel LogLevel, std::string&& Message)
 {
-	//assert(Running == true);
-	LogMessageQueue.Enqueue(FLogMessage{
-		std::chrono::system_clock::to_time_t(std::chrono::system_clock::now()),
-		std::this_thread::get_id(),
-		LogLevel,
-		std::move(Message)
-		});
+	if (!IsEnabled(LogLevel))
+		return;
+	FLogRecord Record;
+	InitializeRecord(Record, LogLevel);
+	Record.MessageSize = uint32_t(Message.size());
+	if (Message.size() <= sizeof(Record.Message))
+	{
+		memcpy(Record.Message, Message.data(), Message.size());
+	}
+	else
+	{
+		Record.LongMessage = new std::string(std::move(Message));
+	}
+	PushRecord(Record);
+}
+
+void CLogger::PushRecord(const FLogRecord& Record)
+{
+	FLogThreadBuffer& ThreadBuffer = GetThreadBuffer();
+	while (!ThreadBuffer.Records.TryEnqueue(Record))
+	{
+		// a sink or callback logging from the logger thread would wait for itself, drop the record
+		if (GDrainingLogger == this)
+		{
+			delete Record.LongMessage;
+			LoggerThreadDroppedRecords++;
+			return;
+		}
+		// backpressure, wait logger thread drain the buffer
+		WakeUp();
+		std::this_thread::yield();
+	}
+	WakeUp();
+}
+
+FLogThreadBuffer& CLogger::GetThreadBuffer()
+{
+	auto& ThreadBuffers = GLogThreadBufferHolder.ThreadBuffers;
+	for (auto& ThreadBuffer : ThreadBuffers)
+	{
+		if (ThreadBuffer.first == LoggerId)
+			return *ThreadBuffer.second;
+	}
+	std::shared_ptr<FLogThreadBuffer> ThreadBuffer = std::make_shared<FLogThreadBuffer>();
+	{
+		std::lock_guard<std::mutex> Lock(ThreadBuffersMutex);
+		this->ThreadBuffers.push_back(ThreadBuffer);
+		ThreadBuffersVersion.fetch_add(1, std::memory_order_release);
+	}
+	ThreadBuffers.emplace_back(LoggerId, ThreadBuffer);
+	return *ThreadBuffer;
+}
+
+void CLogger::WakeUp()
+{
+	// pair with the fence in WaitForWork, either the logger thread see the new record or we see it sleeping
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (Sleeping.load(std::memory_order_relaxed))
+	{
+		std::lock_guard<std::mutex> Lock(WakeUpMutex);
+		WakeUpCondition.notify_one();
+	}
 }
 
 void CLogger::Run()
 {
-	time_t Now = std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
-#ifdef _WIN32
-	tm NowTm = {0};
-	tm* NowTmPtr = &NowTm;
-	localtime_s(NowTmPtr, &Now);
-#else
-	tm* NowTmPtr = localtime(&Now);
-#endif // DEBUG
-	Running = true;
+	TRACE_THREAD_NAME("Logger");
+	GDrainingLogger = this;
 	while (Running) {
-		Loop();
+		if (!Loop())
+			WaitForWork();
 	}
-	Loop();
+	while (Loop());
+	// report every pending repeat and drop counter
+	SweepSuppressed(INT64_MAX);
+	FlushWriteBatch();
 }
 
-void CLogger::Loop() {
+bool CLogger::Loop() {
+	TRACE_SCOPE("CLogger::Loop", "Log");
+	bool Worked = false;
 	std::function<void()> Task;
-	FLogMessage LogMessage;
 	while (TaskQueue.Dequeue(Task))
 	{
 		Task();
+		Worked = true;
+	}
+	if (DrainThreadBuffersVersion != ThreadBuffersVersion.load(std::memory_order_acquire))
+	{
+		std::lock_guard<std::mutex> Lock(ThreadBuffersMutex);
+		DrainThreadBuffers = ThreadBuffers;
+		DrainThreadBuffersVersion = ThreadBuffersVersion.load(std::memory_order_relaxed);
+	}
+	bool HasClosedThreadBuffer = false;
+	for (auto& ThreadBuffer : DrainThreadBuffers)
+	{
+		// read before drain, records pushed before the thread exit are drained below
+		bool Closed = ThreadBuffer->Closed.load(std::memory_order_acquire);
+		uint32_t Count;
+		while ((Count = ThreadBuffer->Records.DequeueBulk(DrainRecords.get(), kDrainRecordsSize)) > 0)
+		{
+			for (uint32_t i = 0; i < Count; i++)
+				WriteRecord(DrainRecords[i]);
+			Worked = true;
+		}
+		HasClosedThreadBuffer |= Closed;
+	}
+	int64_t Now = FLogClock::Now();
+	if (Now - LastSuppressionSweep >= LOG_SUPPRESSION_SWEEP_INTERVAL)
+	{
+		SweepSuppressed(Now);
+		LastSuppressionSweep = Now;
+	}
+	FlushWriteBatch();
+	if (HasClosedThreadBuffer)
+	{
+		std::lock_guard<std::mutex> Lock(ThreadBuffersMutex);
+		std::erase_if(ThreadBuffers, [](const std::shared_ptr<FLogThreadBuffer>& ThreadBuffer) {
+			return ThreadBuffer->Closed.load(std::memory_order_acquire) && ThreadBuffer->Records.IsEmpty();
+			});
+		DrainThreadBuffers = ThreadBuffers;
+		DrainThreadBuffersVersion = ThreadBuffersVersion.fetch_add(1, std::memory_order_release) + 1;
+	}
+	return Worked;
+}
+
+void CLogger::WaitForWork()
+{
+	std::unique_lock<std::mutex> Lock(WakeUpMutex);
+	Sleeping.store(true, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	bool HasWork = !Running || !TaskQueue.IsEmpty();
+	for (size_t i = 0; !HasWork && i < DrainThreadBuffers.size(); i++)
+		HasWork = !DrainThreadBuffers[i]->Records.IsEmpty();
+	// a new thread buffer bump the version, it is picked up by the next Loop
+	HasWork |= DrainThreadBuffersVersion != ThreadBuffersVersion.load(std::memory_order_acquire);
+	if (!HasWork)
+		WakeUpCondition.wait_for(Lock, std::chrono::milliseconds(100));
+	Sleeping.store(false, std::memory_order_relaxed);
+}
+
+void CLogger::WriteRecord(const FLogRecord& Record)
+{
+	std::string_view Message;
+	if (Record.Format)
+	{
+		DeferredMessage.clear();
+		try
+		{
+			Record.Format->FormatArguments(DeferredMessage, Record.Format->Format, Record.Message);
+		}
+		catch (const std::format_error&)
+		{
+			// the format string is not checked at the call site, keep it raw
+			DeferredMessage = Record.Format->Format;
+		}
+		Message = DeferredMessage;
+	}
+	else
+	{
+		Message = Record.GetMessage();
 	}
-	while (LogMessageQueue.Dequeue(LogMessage))
+	if (!Message.empty() && Message.back() == '\n') // remove last \n or \r\n
 	{
-		if (*LogMessage.Message.rbegin() == '\n') // remove last \n or \r\n
+		Message.remove_suffix(1);
+		if (!Message.empty() && Message.back() == '\r')
+			Message.remove_suffix(1);
+	}
+	if (!Suppress(Record, Message))
+		OutputMessage(Record, Message);
+	delete Record.LongMessage;
+}
+
+void CLogger::OutputMessage(const FLogRecordHeader& Record, std::string_view Message)
+{
+	if (ConsoleOutput.load(std::memory_order_relaxed))
+	{
+		int64_t Second = Record.Timestamp / 1000000000;
+		if (Second != CachedTimeSecond)
 		{
-			if (*(LogMessage.Message.rbegin()++) == '\r')
-				LogMessage.Message.resize(LogMessage.Message.size() - 2);
-			else
-				LogMessage.Message.resize(LogMessage.Message.size() - 1);
+			CachedTimeSecond = Second;
+			CachedTime = FormatSystemTime(time_t(Second));
 		}
-		std::string FormatLog =
-			std::format("[{:s}] [{:#010x}] [{:<7s}] {:s}\n",
-				FormatSystemTime(LogMessage.Timestamp),
-				*reinterpret_cast<_Thrd_id_t*>(&LogMessage.ThreadId),
-				ToString(LogMessage.LogLevel),
-				LogMessage.Message);
-		std::cout << FormatLog;
+		std::thread::id ThreadId = Record.ThreadId;
+		std::format_to(std::back_inserter(WriteBatch), "[{:s}.{:09d}] [{:#010x}] [{:<7s}] {:s}\n",
+			CachedTime,
+			Record.Timestamp % 1000000000,
+			*reinterpret_cast<_Thrd_id_t*>(&ThreadId),
+			ToString(Record.LogLevel),
+			Message);
+	}
+	for (size_t i = 0; i < LogSinks.size(); i++)
+	{
+		LogSinks[i]->Write(Record, Message);
+	}
+	if (!LogCallbacks.empty())
+	{
+		FLogMessage LogMessage{ Record.Timestamp, Record.ThreadId, Record.LogLevel, std::string(Message) };
 		for (size_t i = 0; i < LogCallbacks.size(); i++)
 		{
 			(*LogCallbacks[i])(LogMessage);
 		}
 	}
-	std::this_thread::yield();
+	if (WriteBatch.size() >= LOG_WRITE_BATCH_SIZE)
+		FlushWriteBatch();
+}
+
+bool CLogger::Suppress(const FLogRecordHeader& Record, std::string_view Message)
+{
+	if (SuppressionConfig.DedupWindowMilliseconds != 0)
+	{
+		// deferred logs repeat their call site, the arguments (socket names, counters) may differ every time
+		std::string_view Key = Message;
+		if (Record.Format)
+		{
+			Key = Record.Format->Format;
+			if (!Key.empty() && Key.back() == '\n')
+				Key.remove_suffix(1);
+		}
+		SuppressionKey.ThreadId = Record.ThreadId;
+		SuppressionKey.LogLevel = Record.LogLevel;
+		SuppressionKey.Message.assign(Key);
+		auto RepeatedMessage = RepeatedMessages.find(SuppressionKey);
+		if (RepeatedMessage != RepeatedMessages.end())
+		{
+			RepeatedMessage->second.LastTimestamp = Record.Timestamp;
+			RepeatedMessage->second.Count++;
+			return true;
+		}
+		// past the cap new messages are not tracked until the next sweep expire some
+		if (RepeatedMessages.size() < LOG_SUPPRESSION_MAX_ENTRIES)
+		{
+			SuppressionKey.Timestamp = Record.Timestamp;
+			RepeatedMessages.emplace(SuppressionKey, FLogRepeat{ Record.Timestamp, Record.Timestamp, 0 });
+		}
+	}
+	if (SuppressionConfig.RateLimitPerSecond != 0)
+	{
+		auto [It, Inserted] = RateLimits.try_emplace(Record.Format, FLogRateLimit{ double(SuppressionConfig.RateLimitBurst), Record.Timestamp, Record.Timestamp, 0 });
+		FLogRateLimit& RateLimit = It->second;
+		double Elapsed = double(Record.Timestamp - RateLimit.LastRefill) / 1e9;
+		if (Elapsed > 0.0)
+		{
+			RateLimit.Tokens = (std::min)(double(SuppressionConfig.RateLimitBurst), RateLimit.Tokens + Elapsed * SuppressionConfig.RateLimitPerSecond);
+			RateLimit.LastRefill = Record.Timestamp;
+		}
+		if (RateLimit.Tokens < 1.0)
+		{
+			RateLimit.Dropped++;
+			return true;
+		}
+		RateLimit.Tokens -= 1.0;
+	}
+	return false;
+}
+
+void CLogger::SweepSuppressed(int64_t Now)
+{
+	int64_t DedupWindow = int64_t(SuppressionConfig.DedupWindowMilliseconds) * 1000000;
+	for (auto It = RepeatedMessages.begin(); It != RepeatedMessages.end();)
+	{
+		if (Now - It->second.FirstTimestamp < DedupWindow)
+		{
+			It++;
+			continue;
+		}
+		if (It->second.Count != 0)
+		{
+			FLogRecordHeader Summary{ It->second.LastTimestamp, It->first.ThreadId, It->first.LogLevel, 0, nullptr, nullptr };
+			OutputMessage(Summary, std::format("{:s} [repeated {:d} times]", It->first.Message, It->second.Count));
+		}
+		It = RepeatedMessages.erase(It);
+	}
+	if (LoggerThreadDroppedRecords != 0)
+	{
+		FLogRecordHeader Summary{ FLogClock::Now(), std::this_thread::get_id(), ELogLevel::kWarning, 0, nullptr, nullptr };
+		OutputMessage(Summary, std::format("logger thread buffer full, dropped {:d} messages logged by sinks or callbacks", LoggerThreadDroppedRecords));
+		LoggerThreadDroppedRecords = 0;
+	}
+	for (auto It = RateLimits.begin(); It != RateLimits.end();)
+	{
+		FLogRateLimit& RateLimit = It->second;
+		if (RateLimit.Dropped != 0 && Now - RateLimit.LastReport >= 1000000000)
+		{
+			// Now is INT64_MAX when flushing everything, it only decides the expiry
+			FLogRecordHeader Summary{ FLogClock::Now(), std::this_thread::get_id(), ELogLevel::kWarning, 0, nullptr, nullptr };
+			OutputMessage(Summary, std::format("rate limit dropped {:d} messages of \"{:s}\"", RateLimit.Dropped, It->first ? It->first->Format : "unformatted logs"));
+			RateLimit.Dropped = 0;
+			RateLimit.LastReport = Summary.Timestamp;
+		}
+		// idle sites are forgotten, they restart with a full bucket
+		if (RateLimit.Dropped == 0 && Now - RateLimit.LastRefill >= 60 * int64_t(1000000000))
+			It = RateLimits.erase(It);
+		else
+			It++;
+	}
+}
+
+void CLogger::FlushWriteBatch()
+{
+	for (size_t i = 0; i < LogSinks.size(); i++)
+	{
+		LogSinks[i]->Flush();
+	}
+	if (WriteBatch.empty())
+		return;
+	std::cout.write(WriteBatch.data(), WriteBatch.size());
+	std::cout.flush();
+	WriteBatch.clear();
 }
 
 
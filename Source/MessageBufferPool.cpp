@@ -0,0 +1,87 @@
+#include "MessageBufferPool.h"
+#include <cassert>
+#include <algorithm>
+
+FMessageBufferPool& FMessageBufferPool::Get()
+{
+	// never destroyed, messages held by other statics may be released after main
+	static FMessageBufferPool* MessageBufferPool = new FMessageBufferPool();
+	return *MessageBufferPool;
+}
+
+FMessageBufferPool::FMessageBufferPool()
+{
+	for (uint32_t i = 0; i < kNumSizeClasses; i++)
+		SizeClasses[i] = std::make_unique<FSizeClass>(kMaxBlocks[i]);
+}
+
+FMessageBufferPool::~FMessageBufferPool()
+{
+}
+
+uint8_t* FMessageBufferPool::Acquire(uint32_t Size, uint32_t& OutCapacity)
+{
+	for (uint32_t i = 0; i < kNumSizeClasses; i++)
+	{
+		if (Size > kSizeClasses[i])
+			continue;
+		OutCapacity = kSizeClasses[i];
+		uint8_t* Data;
+		if (SizeClasses[i]->FreeBlocks.TryDequeue(Data))
+			return Data;
+		Data = AllocateFromSlab(i);
+		if (Data)
+			return Data;
+		// class budget exhausted
+		break;
+	}
+	HeapAllocationCounter.fetch_add(1, std::memory_order_relaxed);
+	uint8_t* Block = new uint8_t[sizeof(FBlockHeader) + Size];
+	FBlockHeader* BlockHeader = reinterpret_cast<FBlockHeader*>(Block);
+	BlockHeader->SizeClass = kHeapSizeClass;
+	BlockHeader->Capacity = Size;
+	OutCapacity = Size;
+	return Block + sizeof(FBlockHeader);
+}
+
+void FMessageBufferPool::Release(uint8_t* Data)
+{
+	if (Data == nullptr)
+		return;
+	uint8_t* Block = Data - sizeof(FBlockHeader);
+	FBlockHeader* BlockHeader = reinterpret_cast<FBlockHeader*>(Block);
+	if (BlockHeader->SizeClass == kHeapSizeClass)
+	{
+		delete[] Block;
+		return;
+	}
+	assert(BlockHeader->SizeClass < kNumSizeClasses);
+	// free list capacity equal to the class budget, slab blocks always fit
+	[[maybe_unused]] bool Released = SizeClasses[BlockHeader->SizeClass]->FreeBlocks.TryEnqueue(Data);
+	assert(Released);
+}
+
+uint8_t* FMessageBufferPool::AllocateFromSlab(uint32_t SizeClass)
+{
+	FSizeClass& Class = *SizeClasses[SizeClass];
+	std::lock_guard<std::mutex> Lock(Class.SlabMutex);
+	uint8_t* Data;
+	// another thread may have grown the class while we wait the lock
+	if (Class.FreeBlocks.TryDequeue(Data))
+		return Data;
+	uint32_t NumBlocks = std::min(kBlocksPerSlab[SizeClass], kMaxBlocks[SizeClass] - Class.NumBlocks);
+	if (NumBlocks == 0)
+		return nullptr;
+	uint32_t BlockSize = sizeof(FBlockHeader) + kSizeClasses[SizeClass];
+	Class.Slabs.emplace_back(new uint8_t[size_t(BlockSize) * NumBlocks]);
+	uint8_t* Slab = Class.Slabs.back().get();
+	Class.NumBlocks += NumBlocks;
+	for (uint32_t i = 0; i < NumBlocks; i++)
+	{
+		FBlockHeader* BlockHeader = reinterpret_cast<FBlockHeader*>(Slab + size_t(BlockSize) * i);
+		BlockHeader->SizeClass = SizeClass;
+		BlockHeader->Capacity = kSizeClasses[SizeClass];
+		if (i > 0) Class.FreeBlocks.TryEnqueue(Slab + size_t(BlockSize) * i + sizeof(FBlockHeader));
+	}
+	return Slab + sizeof(FBlockHeader);
+}
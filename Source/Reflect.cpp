@@ -1,11 +1,52 @@
 #include <algorithm>
+#include <cstring>
 #include <map>
 #include "Reflect.h"
 #ifdef CORE_MODULE
 #include "Logger.h"
+#include "ReflectSerializer.h"
 #include <chrono>
+
+DEFINE_LOG_CATEGORY(LogReflect)
 #endif // CORE_MODULE
 
+FNameTable::FNameTable()
+	: Names(std::make_unique<TNameMap<uint32_t, false>>())
+{
+}
+
+FNameTable::~FNameTable() = default;
+
+FNameTable& FNameTable::Get()
+{
+	static FNameTable* NameTable = new FNameTable();
+	return *NameTable;
+}
+
+std::string_view FNameTable::Intern(std::string_view Name)
+{
+	if (Name.empty())
+		return std::string_view();
+	std::lock_guard<std::mutex> Lock(Mutex);
+	auto NameIterator = Names->find(Name);
+	if (NameIterator != Names->end())
+		return NameIterator->first;
+	// names are short, pack them in 4KB blocks
+	constexpr size_t kBlockSize = 4096;
+	if (Name.size() > BlockSize - BlockUsed)
+	{
+		BlockSize = (std::max)(kBlockSize, Name.size());
+		Blocks.push_back(std::make_unique<char[]>(BlockSize));
+		BlockUsed = 0;
+	}
+	char* Characters = Blocks.back().get() + BlockUsed;
+	memcpy(Characters, Name.data(), Name.size());
+	BlockUsed += Name.size();
+	std::string_view Interned(Characters, Name.size());
+	Names->Insert(Interned, uint32_t(Names->Num()));
+	return Interned;
+}
+
 FMetaTable::FMetaTable() {
 	Metas.push_back(nullptr);
 }
@@ -18,12 +59,15 @@ FMetaTable& FMetaTable::Get()
 	return MetaTable;
 }
 
-FMeta* FMetaTable::GetMeta(const char* MetaName)
+FMeta* FMetaTable::GetMeta(std::string_view MetaName)
 {
-	auto NameToIdIterator = NameToId.find(MetaName);
-	if (NameToIdIterator != NameToId.end())
-		return Metas[NameToIdIterator->second];
-	return nullptr;
+	return GetMeta(FNameKey(MetaName));
+}
+
+FMeta* FMetaTable::GetMeta(const FNameKey& MetaName)
+{
+	const Uint32* MetaId = NameToId.Find(MetaName);
+	return MetaId ? Metas[*MetaId] : nullptr;
 }
 
 FMeta* FMetaTable::GetMeta(Uint32 MetaId)
@@ -36,18 +80,18 @@ FMeta* FMetaTable::GetMeta(Uint32 MetaId)
 uint32_t FMetaTable::RegisterMetaToTable(FMeta* Meta)
 {
 	assert(Meta != nullptr);
-	assert(std::end(NameToId) == NameToId.find(Meta->Name));
+	assert(NameToId.Find(Meta->Name) == nullptr);
 	if (Meta->Id == UINT32_MAX) {
 		Meta->Id = IdCounter++;
 		Metas.push_back(Meta);
-		NameToId.insert(std::make_pair(Meta->Name, Meta->Id));
+		NameToId.Insert(Meta->Name, Meta->Id);
 	}
 	else
 	{
 #ifdef COMPILE_REFLECTOR
 		Meta->Alias.push_back(Meta->Name);
 #endif
-		NameToId.insert(std::make_pair(Meta->Name, Meta->Id));
+		NameToId.Insert(Meta->Name, Meta->Id);
 	}
 	return Meta->Id;
 }
@@ -146,9 +190,8 @@ void FMetaTable::Initialize()
 		delete Ref.second;
 		});
 
-	std::for_each(NameToId.begin(), NameToId.end(), [&](std::map<std::string, Uint32>::reference Ref) {
+	for (auto& Ref : NameToId)
 		Ref.second = RemapId.find(Ref.second)->second;
-		});
 
 	// Initialize StatiFMetaId
 	while (!StaticMetaIdInitializerList.empty())
@@ -157,7 +200,13 @@ void FMetaTable::Initialize()
 		StaticMetaIdInitializerList.pop_front();
 	}
 #ifdef CORE_MODULE
+	// compile serialization plans now instead of on the first message
+	for (size_t i = 1; i < Metas.size(); i++)
+	{
+		if (FClass* Class = dynamic_cast<FClass*>(Metas[i]))
+			FReflectSerializer::CompilePlan(Class);
+	}
 	std::chrono::steady_clock::time_point End = std::chrono::steady_clock::now();
-	GLogger->Log(ELogLevel::kDebug, "GMetaTable Initialize in {:f} seconds", std::chrono::duration<double>(End - Start).count());
+	LOG_CATEGORY(LogReflect, ELogLevel::kDebug, "GMetaTable Initialize in {:f} seconds", std::chrono::duration<double>(End - Start).count());
 #endif // CORE_MODULE
 }
\ No newline at end of file
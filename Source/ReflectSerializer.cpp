@@ -0,0 +1,834 @@
+#include "ReflectSerializer.h"
+#include <string>
+#include <cstring>
+#include <mutex>
+#include <format>
+#include <algorithm>
+#include <memory>
+#include <string_view>
+#include <type_traits>
+#include <unordered_map>
+#include "Logger.h"
+#include "BinaryEncoding.h"
+
+namespace
+{
+	constexpr Uint32 kNumericTypeMask = EPF_BoolFlag | EPF_IntegerMaskBitFlag | EPF_FloatingPointMaskBitFlag;
+
+	// call Function with a value of the numeric type of TypeFlag, return false for other types
+	template<typename TFunction>
+	bool DispatchNumericType(Uint32 TypeFlag, TFunction&& Function)
+	{
+		switch (TypeFlag & kNumericTypeMask)
+		{
+		case EPF_BoolFlag:   return Function(Bool());
+		case EPF_Int8Flag:   return Function(Int8());
+		case EPF_Int16Flag:  return Function(Int16());
+		case EPF_Int32Flag:  return Function(Int32());
+		case EPF_Int64Flag:  return Function(Int64());
+		case EPF_UInt8Flag:  return Function(Uint8());
+		case EPF_UInt16Flag: return Function(Uint16());
+		case EPF_UInt32Flag: return Function(Uint32());
+		case EPF_UInt64Flag: return Function(Uint64());
+		case EPF_FloatFlag:  return Function(Float());
+		case EPF_DoubleFlag: return Function(Double());
+		default:             return false;
+		}
+	}
+
+	template<typename T, typename TWriter>
+	void WriteNumeric(TWriter& Writer, const T& Value)
+	{
+		if constexpr (sizeof(T) == 1)
+			Writer.WriteByte(uint8_t(Value));
+		else if constexpr (std::is_floating_point_v<T>)
+			Writer.Write(&Value, sizeof(T));
+		else if constexpr (std::is_signed_v<T>)
+			WriteVarint(Writer, ZigZagEncode(Value));
+		else
+			WriteVarint(Writer, Value);
+	}
+
+	template<typename T>
+	bool ReadNumeric(FReader& Reader, T& Value)
+	{
+		if constexpr (sizeof(T) == 1)
+		{
+			uint8_t Byte;
+			if (!Reader.ReadByte(Byte))
+				return false;
+			if constexpr (std::is_same_v<T, Bool>)
+				Value = Byte != 0;
+			else
+				Value = T(Byte);
+			return true;
+		}
+		else if constexpr (std::is_floating_point_v<T>)
+		{
+			return Reader.Read(&Value, sizeof(T));
+		}
+		else
+		{
+			uint64_t Varint;
+			if (!Reader.ReadVarint(Varint))
+				return false;
+			if constexpr (std::is_signed_v<T>)
+				Value = T(ZigZagDecode(Varint));
+			else
+				Value = T(Varint);
+			return true;
+		}
+	}
+
+	template<typename TWriter>
+	void WriteString(TWriter& Writer, const std::string& String)
+	{
+		WriteVarint(Writer, String.size());
+		Writer.Write(String.data(), String.size());
+	}
+
+	bool ReadString(FReader& Reader, std::string& String)
+	{
+		uint64_t Size;
+		if (!Reader.ReadVarint(Size) || Size > uint64_t(Reader.End - Reader.Data))
+			return false;
+		String.assign(reinterpret_cast<const char*>(Reader.Data), size_t(Size));
+		Reader.Data += Size;
+		return true;
+	}
+
+	const FClass* GetPropertyClass(const FProperty* Property)
+	{
+		return dynamic_cast<const FClass*>(Property->GetMetaPropertyValue());
+	}
+
+	const FEnum* GetPropertyEnum(const FProperty* Property)
+	{
+		return dynamic_cast<const FEnum*>(Property->GetMetaPropertyValue());
+	}
+
+	// a renamed field or a field changing its type or its array size is a new field for the peer
+	uint32_t GetFieldTag(const FProperty* Property)
+	{
+		Uint32 TypeFlag = Property->Flag & (EPF_TypeMaskBitFlag | EPF_ArrayFlag | EPF_MapFlag);
+		return HashUint32(HashUint32(HashString(kFnvOffsetBasis, Property->Name), TypeFlag), Property->Number);
+	}
+}
+
+namespace EReflectSerializeOp
+{
+	enum Type : Uint8
+	{
+		// Size bytes encoded as they are in memory
+		Copy,
+		Bool,
+		Varint16,
+		Varint32,
+		Varint64,
+		ZigZag8,
+		ZigZag16,
+		ZigZag32,
+		ZigZag64,
+		String,
+		// std::vector of the numeric type TypeFlag
+		NumericArray,
+		StringArray,
+	};
+}
+
+struct FReflectSerializeOp
+{
+	EReflectSerializeOp::Type Type;
+	Uint32 Offset;
+	// bytes of a Copy
+	Uint32 Size;
+	Uint32 TypeFlag;
+};
+
+// one property of the tagged encoding
+struct FReflectTaggedField
+{
+	uint32_t Tag;
+	// ops of the value, offsets are relative to the object, empty for struct and class fields
+	std::vector<FReflectSerializeOp> Ops;
+	// struct and class fields, every element is a nested tagged object
+	const FClass* Class;
+	Uint32 Offset;
+	Uint32 Number;
+};
+
+// properties of a class, its parents and nested classes flattened into one op array,
+// neighbour fields encoded as they are in memory are merged into one Copy
+struct FReflectSerializePlan
+{
+	std::vector<FReflectSerializeOp> Ops;
+	// empty when the class can be serialized
+	std::string Error;
+	// hash of the class name, FMeta::Id is assigned at runtime and differ between builds
+	uint32_t ClassHash;
+	// fields of the tagged encoding, parent class first
+	std::vector<FReflectTaggedField> TaggedFields;
+	// tag to index in TaggedFields
+	std::unordered_map<uint32_t, Int32> TagToField;
+};
+
+namespace
+{
+	struct FReflectSerializePlanRegistry
+	{
+		std::mutex Mutex;
+		std::vector<std::unique_ptr<FReflectSerializePlan>> Plans;
+	};
+
+	FReflectSerializePlanRegistry& GetReflectSerializePlanRegistry()
+	{
+		static FReflectSerializePlanRegistry* Registry = new FReflectSerializePlanRegistry();
+		return *Registry;
+	}
+
+	void AddOp(FReflectSerializePlan& Plan, EReflectSerializeOp::Type Type, Uint32 Offset, Uint32 Size = 0, Uint32 TypeFlag = 0)
+	{
+		if (Type == EReflectSerializeOp::Copy && !Plan.Ops.empty())
+		{
+			FReflectSerializeOp& Last = Plan.Ops.back();
+			if (Last.Type == EReflectSerializeOp::Copy && Last.Offset + Last.Size == Offset)
+			{
+				Last.Size += Size;
+				return;
+			}
+		}
+		Plan.Ops.push_back(FReflectSerializeOp{ Type, Offset, Size, TypeFlag });
+	}
+
+	bool CompileElement(FReflectSerializePlan& Plan, const FClass* Class, const FProperty* Property, Uint32 Offset, Uint32& OutElementSize);
+
+	bool CompileProperty(FReflectSerializePlan& Plan, const FClass* Class, const FProperty* Property, Uint32 Offset)
+	{
+		if (Property->Flag & EPF_MapFlag)
+		{
+			Plan.Error = std::format("{:s}::{:s} Map Is Not Supported", Class->Name, Property->Name);
+			return false;
+		}
+		if (Property->Flag & EPF_ArrayFlag)
+		{
+			if (Property->Flag & EPF_StringFlag)
+			{
+				AddOp(Plan, EReflectSerializeOp::StringArray, Offset);
+			}
+			else if (Property->Flag & (EPF_BoolFlag | EPF_IntegerMaskBitFlag | EPF_FloatingPointMaskBitFlag))
+			{
+				AddOp(Plan, EReflectSerializeOp::NumericArray, Offset, 0, Property->Flag);
+			}
+			else
+			{
+				Plan.Error = std::format("{:s}::{:s} Array Element Type Is Not Supported", Class->Name, Property->Name);
+				return false;
+			}
+			return true;
+		}
+		for (Uint32 i = 0; i < Property->Number; i++)
+		{
+			Uint32 ElementSize;
+			if (!CompileElement(Plan, Class, Property, Offset, ElementSize))
+				return false;
+			Offset += ElementSize;
+		}
+		return true;
+	}
+
+	bool CompileClass(FReflectSerializePlan& Plan, const FClass* Class, Uint32 BaseOffset)
+	{
+		if (Class->Parent && !CompileClass(Plan, Class->Parent, BaseOffset))
+			return false;
+		for (const FProperty* Property : Class->Properties)
+		{
+			// pointer and reference properties are not serialized
+			if (Property->Flag & (EPF_PointerFlag | EPF_ReferenceFlag))
+				continue;
+			if (!CompileProperty(Plan, Class, Property, BaseOffset + Property->Offset))
+				return false;
+		}
+		return true;
+	}
+
+	// nested classes are not flattened, their own plan decode them so they evolve independently
+	bool CompileTaggedClass(FReflectSerializePlan& Plan, const FClass* Class)
+	{
+		if (Class->Parent && !CompileTaggedClass(Plan, Class->Parent))
+			return false;
+		for (const FProperty* Property : Class->Properties)
+		{
+			if (Property->Flag & (EPF_PointerFlag | EPF_ReferenceFlag))
+				continue;
+			FReflectTaggedField Field{ GetFieldTag(Property), {}, nullptr, Uint32(Property->Offset), Property->Number };
+			if ((Property->Flag & (EPF_StructFlag | EPF_ClassFlag)) && !(Property->Flag & (EPF_ArrayFlag | EPF_MapFlag)))
+			{
+				Field.Class = GetPropertyClass(Property);
+				if (Field.Class == nullptr)
+				{
+					Plan.Error = std::format("{:s}::{:s} Has No Class", Class->Name, Property->Name);
+					return false;
+				}
+			}
+			else
+			{
+				FReflectSerializePlan FieldPlan;
+				if (!CompileProperty(FieldPlan, Class, Property, Field.Offset))
+				{
+					Plan.Error = std::move(FieldPlan.Error);
+					return false;
+				}
+				Field.Ops = std::move(FieldPlan.Ops);
+			}
+			if (!Plan.TagToField.emplace(Field.Tag, Int32(Plan.TaggedFields.size())).second)
+			{
+				Plan.Error = std::format("{:s}::{:s} Tag Collides With Another Field", Class->Name, Property->Name);
+				return false;
+			}
+			Plan.TaggedFields.push_back(std::move(Field));
+		}
+		return true;
+	}
+
+	bool CompileElement(FReflectSerializePlan& Plan, const FClass* Class, const FProperty* Property, Uint32 Offset, Uint32& OutElementSize)
+	{
+		if (Property->Flag & EPF_StringFlag)
+		{
+			AddOp(Plan, EReflectSerializeOp::String, Offset);
+			OutElementSize = sizeof(std::string);
+			return true;
+		}
+		if (Property->Flag & (EPF_StructFlag | EPF_ClassFlag))
+		{
+			const FClass* PropertyClass = GetPropertyClass(Property);
+			if (PropertyClass == nullptr)
+			{
+				Plan.Error = std::format("{:s}::{:s} Has No Class", Class->Name, Property->Name);
+				return false;
+			}
+			OutElementSize = Uint32(PropertyClass->Size);
+			return CompileClass(Plan, PropertyClass, Offset);
+		}
+		if (Property->Flag & EPF_EnumFlag)
+		{
+			const FEnum* Enum = GetPropertyEnum(Property);
+			if (Enum == nullptr)
+			{
+				Plan.Error = std::format("{:s}::{:s} Has No Enum", Class->Name, Property->Name);
+				return false;
+			}
+			OutElementSize = Enum->Size;
+			switch (Enum->Size)
+			{
+			case 1: AddOp(Plan, EReflectSerializeOp::ZigZag8, Offset); break;
+			case 2: AddOp(Plan, EReflectSerializeOp::ZigZag16, Offset); break;
+			case 4: AddOp(Plan, EReflectSerializeOp::ZigZag32, Offset); break;
+			default: AddOp(Plan, EReflectSerializeOp::ZigZag64, Offset); break;
+			}
+			return true;
+		}
+		bool Compiled = DispatchNumericType(Property->Flag, [&](auto Value) {
+			using T = decltype(Value);
+			OutElementSize = sizeof(T);
+			if constexpr (std::is_same_v<T, Bool>)
+				AddOp(Plan, EReflectSerializeOp::Bool, Offset);
+			else if constexpr (sizeof(T) == 1 || std::is_floating_point_v<T>)
+				AddOp(Plan, EReflectSerializeOp::Copy, Offset, sizeof(T));
+			else if constexpr (std::is_signed_v<T>)
+				AddOp(Plan, sizeof(T) == 2 ? EReflectSerializeOp::ZigZag16 : sizeof(T) == 4 ? EReflectSerializeOp::ZigZag32 : EReflectSerializeOp::ZigZag64, Offset);
+			else
+				AddOp(Plan, sizeof(T) == 2 ? EReflectSerializeOp::Varint16 : sizeof(T) == 4 ? EReflectSerializeOp::Varint32 : EReflectSerializeOp::Varint64, Offset);
+			return true;
+			});
+		if (!Compiled)
+			Plan.Error = std::format("{:s}::{:s} Type Is Not Supported", Class->Name, Property->Name);
+		return Compiled;
+	}
+
+	const FReflectSerializePlan& GetSerializePlan(const FClass* Class)
+	{
+		const FReflectSerializePlan* Plan = Class->SerializePlan.load(std::memory_order_acquire);
+		if (Plan)
+			return *Plan;
+		FReflectSerializePlanRegistry& Registry = GetReflectSerializePlanRegistry();
+		std::lock_guard<std::mutex> Lock(Registry.Mutex);
+		Plan = Class->SerializePlan.load(std::memory_order_relaxed);
+		if (Plan)
+			return *Plan;
+		std::unique_ptr<FReflectSerializePlan> NewPlan = std::make_unique<FReflectSerializePlan>();
+		NewPlan->ClassHash = HashString(kFnvOffsetBasis, Class->Name);
+		if (!CompileClass(*NewPlan, Class, 0) || !CompileTaggedClass(*NewPlan, Class))
+		{
+			NewPlan->Ops.clear();
+			NewPlan->TaggedFields.clear();
+			NewPlan->TagToField.clear();
+		}
+		Plan = NewPlan.get();
+		Registry.Plans.push_back(std::move(NewPlan));
+		Class->SerializePlan.store(Plan, std::memory_order_release);
+		return *Plan;
+	}
+
+	template<typename T>
+	const T& Load(const uint8_t* Address) { return *reinterpret_cast<const T*>(Address); }
+
+	template<typename T>
+	T& Load(uint8_t* Address) { return *reinterpret_cast<T*>(Address); }
+
+	template<typename TWriter>
+	void WritePlan(TWriter& Writer, const std::vector<FReflectSerializeOp>& Ops, const uint8_t* Object)
+	{
+		for (const FReflectSerializeOp& Op : Ops)
+		{
+			const uint8_t* Address = Object + Op.Offset;
+			switch (Op.Type)
+			{
+			case EReflectSerializeOp::Copy:     Writer.Write(Address, Op.Size); break;
+			case EReflectSerializeOp::Bool:     Writer.WriteByte(Load<Bool>(Address) ? 1 : 0); break;
+			case EReflectSerializeOp::Varint16: WriteVarint(Writer, Load<Uint16>(Address)); break;
+			case EReflectSerializeOp::Varint32: WriteVarint(Writer, Load<Uint32>(Address)); break;
+			case EReflectSerializeOp::Varint64: WriteVarint(Writer, Load<Uint64>(Address)); break;
+			case EReflectSerializeOp::ZigZag8:  WriteVarint(Writer, ZigZagEncode(Load<int8_t>(Address))); break;
+			case EReflectSerializeOp::ZigZag16: WriteVarint(Writer, ZigZagEncode(Load<Int16>(Address))); break;
+			case EReflectSerializeOp::ZigZag32: WriteVarint(Writer, ZigZagEncode(Load<Int32>(Address))); break;
+			case EReflectSerializeOp::ZigZag64: WriteVarint(Writer, ZigZagEncode(Load<Int64>(Address))); break;
+			case EReflectSerializeOp::String:   WriteString(Writer, Load<std::string>(Address)); break;
+			case EReflectSerializeOp::StringArray:
+			{
+				const std::vector<std::string>& Array = Load<std::vector<std::string>>(Address);
+				WriteVarint(Writer, Array.size());
+				for (const std::string& Element : Array)
+					WriteString(Writer, Element);
+				break;
+			}
+			case EReflectSerializeOp::NumericArray:
+				DispatchNumericType(Op.TypeFlag, [&](auto Value) {
+					using T = decltype(Value);
+					const std::vector<T>& Array = Load<std::vector<T>>(Address);
+					WriteVarint(Writer, Array.size());
+					if constexpr (!std::is_same_v<T, Bool> && (sizeof(T) == 1 || std::is_floating_point_v<T>))
+						Writer.Write(Array.data(), Array.size() * sizeof(T));
+					else
+						for (T Element : Array)
+							WriteNumeric(Writer, Element);
+					return true;
+					});
+				break;
+			}
+		}
+	}
+
+	template<typename T>
+	bool ReadVarint(FReader& Reader, uint8_t* Address)
+	{
+		uint64_t Varint;
+		if (!Reader.ReadVarint(Varint))
+			return false;
+		if constexpr (std::is_signed_v<T>)
+			Load<T>(Address) = T(ZigZagDecode(Varint));
+		else
+			Load<T>(Address) = T(Varint);
+		return true;
+	}
+
+	bool ReadPlan(FReader& Reader, const std::vector<FReflectSerializeOp>& Ops, uint8_t* Object)
+	{
+		for (const FReflectSerializeOp& Op : Ops)
+		{
+			uint8_t* Address = Object + Op.Offset;
+			bool Succeeded = false;
+			switch (Op.Type)
+			{
+			case EReflectSerializeOp::Copy:     Succeeded = Reader.Read(Address, Op.Size); break;
+			case EReflectSerializeOp::Bool:     Succeeded = ReadNumeric(Reader, Load<Bool>(Address)); break;
+			case EReflectSerializeOp::Varint16: Succeeded = ReadVarint<Uint16>(Reader, Address); break;
+			case EReflectSerializeOp::Varint32: Succeeded = ReadVarint<Uint32>(Reader, Address); break;
+			case EReflectSerializeOp::Varint64: Succeeded = ReadVarint<Uint64>(Reader, Address); break;
+			case EReflectSerializeOp::ZigZag8:  Succeeded = ReadVarint<int8_t>(Reader, Address); break;
+			case EReflectSerializeOp::ZigZag16: Succeeded = ReadVarint<Int16>(Reader, Address); break;
+			case EReflectSerializeOp::ZigZag32: Succeeded = ReadVarint<Int32>(Reader, Address); break;
+			case EReflectSerializeOp::ZigZag64: Succeeded = ReadVarint<Int64>(Reader, Address); break;
+			case EReflectSerializeOp::String:   Succeeded = ReadString(Reader, Load<std::string>(Address)); break;
+			case EReflectSerializeOp::StringArray:
+			{
+				uint64_t Count;
+				// every element take at least one byte, reject a corrupt count before allocating
+				if (!Reader.ReadVarint(Count) || Count > uint64_t(Reader.End - Reader.Data))
+					break;
+				std::vector<std::string>& Array = Load<std::vector<std::string>>(Address);
+				Array.resize(size_t(Count));
+				Succeeded = true;
+				for (size_t i = 0; i < Array.size() && Succeeded; i++)
+					Succeeded = ReadString(Reader, Array[i]);
+				break;
+			}
+			case EReflectSerializeOp::NumericArray:
+			{
+				uint64_t Count;
+				if (!Reader.ReadVarint(Count) || Count > uint64_t(Reader.End - Reader.Data))
+					break;
+				Succeeded = DispatchNumericType(Op.TypeFlag, [&](auto Value) {
+					using T = decltype(Value);
+					std::vector<T>& Array = Load<std::vector<T>>(Address);
+					Array.resize(size_t(Count));
+					if constexpr (!std::is_same_v<T, Bool> && (sizeof(T) == 1 || std::is_floating_point_v<T>))
+						return Reader.Read(Array.data(), Array.size() * sizeof(T));
+					for (size_t i = 0; i < Array.size(); i++)
+					{
+						// std::vector<bool> has no addressable elements
+						if (!ReadNumeric(Reader, Value))
+							return false;
+						Array[i] = Value;
+					}
+					return true;
+					});
+				break;
+			}
+			}
+			if (!Succeeded)
+				return false;
+		}
+		return true;
+	}
+
+	bool CheckPlan(const FClass* Class, const FReflectSerializePlan& Plan)
+	{
+		if (Plan.Error.empty())
+			return true;
+		LOG_CATEGORY(LogReflect, ELogLevel::kError, "Serialize {:s} Failed, {:s}", Class->Name, Plan.Error);
+		return false;
+	}
+
+	template<typename TWriter>
+	void WriteTagged(TWriter& Writer, const FReflectSerializePlan& Plan, const uint8_t* Object);
+
+	// length prefixed payload of a nested tagged object, the size writer skip the second pass
+	template<typename TWriter>
+	void WriteTaggedObject(TWriter& Writer, const FReflectSerializePlan& Plan, const uint8_t* Object)
+	{
+		FSizeWriter SizeWriter;
+		WriteTagged(SizeWriter, Plan, Object);
+		WriteVarint(Writer, SizeWriter.Size);
+		if constexpr (std::is_same_v<TWriter, FSizeWriter>)
+			Writer.Size += SizeWriter.Size;
+		else
+			WriteTagged(Writer, Plan, Object);
+	}
+
+	// every field is its 4 bytes tag, a varint payload size and the payload
+	template<typename TWriter>
+	void WriteTagged(TWriter& Writer, const FReflectSerializePlan& Plan, const uint8_t* Object)
+	{
+		for (const FReflectTaggedField& Field : Plan.TaggedFields)
+		{
+			WriteFixed32(Writer, Field.Tag);
+			if (Field.Class == nullptr)
+			{
+				FSizeWriter SizeWriter;
+				WritePlan(SizeWriter, Field.Ops, Object);
+				WriteVarint(Writer, SizeWriter.Size);
+				WritePlan(Writer, Field.Ops, Object);
+				continue;
+			}
+			const FReflectSerializePlan& FieldPlan = GetSerializePlan(Field.Class);
+			const uint8_t* Element = Object + Field.Offset;
+			if (Field.Number == 1)
+			{
+				WriteTaggedObject(Writer, FieldPlan, Element);
+				continue;
+			}
+			// fixed array of objects, every element is length prefixed inside the payload
+			FSizeWriter SizeWriter;
+			for (Uint32 i = 0; i < Field.Number; i++)
+				WriteTaggedObject(SizeWriter, FieldPlan, Element + i * Field.Class->Size);
+			WriteVarint(Writer, SizeWriter.Size);
+			if constexpr (std::is_same_v<TWriter, FSizeWriter>)
+				Writer.Size += SizeWriter.Size;
+			else
+				for (Uint32 i = 0; i < Field.Number; i++)
+					WriteTaggedObject(Writer, FieldPlan, Element + i * Field.Class->Size);
+		}
+	}
+
+	bool ReadTagged(FReader& Reader, const FClass* Class, const FReflectSerializePlan& Plan, uint8_t* Object, FReflectPeerSchema* PeerSchema);
+
+	bool ReadTaggedObject(FReader& Reader, const FClass* Class, const FReflectSerializePlan& Plan, uint8_t* Object, FReflectPeerSchema* PeerSchema)
+	{
+		uint64_t Size;
+		if (!Reader.ReadVarint(Size) || Size > uint64_t(Reader.End - Reader.Data))
+			return false;
+		FReader ObjectReader{ Reader.Data, Reader.Data + Size };
+		Reader.Data += Size;
+		return ReadTagged(ObjectReader, Class, Plan, Object, PeerSchema);
+	}
+
+	bool ReadTaggedField(FReader& Reader, const FReflectTaggedField& Field, uint8_t* Object, FReflectPeerSchema* PeerSchema)
+	{
+		if (Field.Class == nullptr)
+			return ReadPlan(Reader, Field.Ops, Object);
+		const FReflectSerializePlan& FieldPlan = GetSerializePlan(Field.Class);
+		if (!FieldPlan.Error.empty())
+			return false;
+		uint8_t* Element = Object + Field.Offset;
+		if (Field.Number == 1)
+			return ReadTagged(Reader, Field.Class, FieldPlan, Element, PeerSchema);
+		for (Uint32 i = 0; i < Field.Number; i++)
+		{
+			if (!ReadTaggedObject(Reader, Field.Class, FieldPlan, Element + i * Field.Class->Size, PeerSchema))
+				return false;
+		}
+		return true;
+	}
+
+	// fields missing from the data keep their value, unknown fields are skipped by their size
+	bool ReadTagged(FReader& Reader, const FClass* Class, const FReflectSerializePlan& Plan, uint8_t* Object, FReflectPeerSchema* PeerSchema)
+	{
+		const FReflectPeerClass* PeerClass = PeerSchema ? PeerSchema->FindClass(Class) : nullptr;
+		size_t Position = 0;
+		while (Reader.Data != Reader.End)
+		{
+			uint32_t Tag;
+			uint64_t Size;
+			if (!Reader.ReadFixed32(Tag) || !Reader.ReadVarint(Size) || Size > uint64_t(Reader.End - Reader.Data))
+				return false;
+			FReader FieldReader{ Reader.Data, Reader.Data + Size };
+			Reader.Data += Size;
+			Int32 FieldIndex = -1;
+			// the peer write its fields in the order of its schema, a match at the same position skip the tag lookup
+			if (PeerClass && Position < PeerClass->Tags.size() && PeerClass->Tags[Position] == Tag)
+			{
+				FieldIndex = PeerClass->LocalFields[Position];
+			}
+			else
+			{
+				auto It = Plan.TagToField.find(Tag);
+				if (It != Plan.TagToField.end())
+					FieldIndex = It->second;
+			}
+			Position++;
+			if (FieldIndex >= 0 && !ReadTaggedField(FieldReader, Plan.TaggedFields[FieldIndex], Object, PeerSchema))
+				return false;
+		}
+		return true;
+	}
+
+	void CollectSchemaClasses(const FClass* Class, std::vector<const FClass*>& Classes)
+	{
+		if (std::find(Classes.begin(), Classes.end(), Class) != Classes.end())
+			return;
+		Classes.push_back(Class);
+		for (const FReflectTaggedField& Field : GetSerializePlan(Class).TaggedFields)
+		{
+			if (Field.Class)
+				CollectSchemaClasses(Field.Class, Classes);
+		}
+	}
+}
+
+bool FReflectSerializer::CompilePlan(const FClass* Class)
+{
+	assert(Class);
+	return GetSerializePlan(Class).Error.empty();
+}
+
+bool FReflectSerializer::Serialize(const FClass* Class, const void* Object, std::vector<uint8_t>& Out)
+{
+	assert(Class && Object);
+	const FReflectSerializePlan& Plan = GetSerializePlan(Class);
+	if (!CheckPlan(Class, Plan))
+		return false;
+	FSizeWriter SizeWriter;
+	WritePlan(SizeWriter, Plan.Ops, static_cast<const uint8_t*>(Object));
+	size_t Offset = Out.size();
+	Out.resize(Offset + SizeWriter.Size);
+	FBufferWriter BufferWriter{ Out.data() + Offset };
+	WritePlan(BufferWriter, Plan.Ops, static_cast<const uint8_t*>(Object));
+	return true;
+}
+
+bool FReflectSerializer::Serialize(const FClass* Class, const void* Object, FMessageData& MessageData)
+{
+	assert(Class && Object);
+	const FReflectSerializePlan& Plan = GetSerializePlan(Class);
+	if (!CheckPlan(Class, Plan))
+		return false;
+	FSizeWriter SizeWriter;
+	WritePlan(SizeWriter, Plan.Ops, static_cast<const uint8_t*>(Object));
+	MessageData.SetBodySize(static_cast<uint32_t>(SizeWriter.Size));
+	FBufferWriter BufferWriter{ MessageData.GetBody<uint8_t>() };
+	WritePlan(BufferWriter, Plan.Ops, static_cast<const uint8_t*>(Object));
+	return true;
+}
+
+bool FReflectSerializer::Deserialize(const FClass* Class, void* Object, const uint8_t* Data, size_t Size, size_t* OutReadSize)
+{
+	assert(Class && Object);
+	const FReflectSerializePlan& Plan = GetSerializePlan(Class);
+	if (!CheckPlan(Class, Plan))
+		return false;
+	FReader Reader{ Data, Data + Size };
+	if (!ReadPlan(Reader, Plan.Ops, static_cast<uint8_t*>(Object)))
+	{
+		LOG_CATEGORY(LogReflect, ELogLevel::kWarning, "Deserialize {:s} Failed, Data Is Truncated Or Corrupt", Class->Name);
+		return false;
+	}
+	if (OutReadSize)
+		*OutReadSize = size_t(Reader.Data - Data);
+	return true;
+}
+
+bool FReflectSerializer::Deserialize(const FClass* Class, void* Object, FMessageData& MessageData)
+{
+	return Deserialize(Class, Object, MessageData.GetBody<uint8_t>(), MessageData.GetBodySize());
+}
+
+bool FReflectSerializer::SerializeTagged(const FClass* Class, const void* Object, std::vector<uint8_t>& Out)
+{
+	assert(Class && Object);
+	const FReflectSerializePlan& Plan = GetSerializePlan(Class);
+	if (!CheckPlan(Class, Plan))
+		return false;
+	FSizeWriter SizeWriter;
+	WriteTagged(SizeWriter, Plan, static_cast<const uint8_t*>(Object));
+	size_t Offset = Out.size();
+	Out.resize(Offset + sizeof(Plan.ClassHash) + SizeWriter.Size);
+	FBufferWriter BufferWriter{ Out.data() + Offset };
+	WriteFixed32(BufferWriter, Plan.ClassHash);
+	WriteTagged(BufferWriter, Plan, static_cast<const uint8_t*>(Object));
+	return true;
+}
+
+bool FReflectSerializer::SerializeTagged(const FClass* Class, const void* Object, FMessageData& MessageData)
+{
+	assert(Class && Object);
+	const FReflectSerializePlan& Plan = GetSerializePlan(Class);
+	if (!CheckPlan(Class, Plan))
+		return false;
+	FSizeWriter SizeWriter;
+	WriteTagged(SizeWriter, Plan, static_cast<const uint8_t*>(Object));
+	MessageData.SetBodySize(static_cast<uint32_t>(sizeof(Plan.ClassHash) + SizeWriter.Size));
+	FBufferWriter BufferWriter{ MessageData.GetBody<uint8_t>() };
+	WriteFixed32(BufferWriter, Plan.ClassHash);
+	WriteTagged(BufferWriter, Plan, static_cast<const uint8_t*>(Object));
+	return true;
+}
+
+bool FReflectSerializer::DeserializeTagged(const FClass* Class, void* Object, const uint8_t* Data, size_t Size, FReflectPeerSchema* PeerSchema)
+{
+	assert(Class && Object);
+	const FReflectSerializePlan& Plan = GetSerializePlan(Class);
+	if (!CheckPlan(Class, Plan))
+		return false;
+	FReader Reader{ Data, Data + Size };
+	uint32_t ClassHash;
+	if (!Reader.ReadFixed32(ClassHash) || ClassHash != Plan.ClassHash)
+	{
+		LOG_CATEGORY(LogReflect, ELogLevel::kWarning, "Deserialize {:s} Failed, Data Is Not Of This Class", Class->Name);
+		return false;
+	}
+	if (!ReadTagged(Reader, Class, Plan, static_cast<uint8_t*>(Object), PeerSchema))
+	{
+		LOG_CATEGORY(LogReflect, ELogLevel::kWarning, "Deserialize {:s} Failed, Data Is Truncated Or Corrupt", Class->Name);
+		return false;
+	}
+	return true;
+}
+
+bool FReflectSerializer::DeserializeTagged(const FClass* Class, void* Object, FMessageData& MessageData, FReflectPeerSchema* PeerSchema)
+{
+	return DeserializeTagged(Class, Object, MessageData.GetBody<uint8_t>(), MessageData.GetBodySize(), PeerSchema);
+}
+
+uint32_t FReflectSerializer::GetClassHash(const FClass* Class)
+{
+	assert(Class);
+	return GetSerializePlan(Class).ClassHash;
+}
+
+bool FReflectSerializer::SerializeSchema(const FClass* Class, std::vector<uint8_t>& Out)
+{
+	assert(Class);
+	if (!CheckPlan(Class, GetSerializePlan(Class)))
+		return false;
+	std::vector<const FClass*> Classes;
+	CollectSchemaClasses(Class, Classes);
+	FSizeWriter SizeWriter;
+	WriteVarint(SizeWriter, Classes.size());
+	for (const FClass* SchemaClass : Classes)
+	{
+		const FReflectSerializePlan& Plan = GetSerializePlan(SchemaClass);
+		WriteFixed32(SizeWriter, Plan.ClassHash);
+		WriteVarint(SizeWriter, Plan.TaggedFields.size());
+		SizeWriter.Write(nullptr, Plan.TaggedFields.size() * sizeof(uint32_t));
+	}
+	size_t Offset = Out.size();
+	Out.resize(Offset + SizeWriter.Size);
+	FBufferWriter BufferWriter{ Out.data() + Offset };
+	WriteVarint(BufferWriter, Classes.size());
+	for (const FClass* SchemaClass : Classes)
+	{
+		const FReflectSerializePlan& Plan = GetSerializePlan(SchemaClass);
+		WriteFixed32(BufferWriter, Plan.ClassHash);
+		WriteVarint(BufferWriter, Plan.TaggedFields.size());
+		for (const FReflectTaggedField& Field : Plan.TaggedFields)
+			WriteFixed32(BufferWriter, Field.Tag);
+	}
+	return true;
+}
+
+bool FReflectPeerSchema::AddSchema(const uint8_t* Data, size_t Size)
+{
+	FReader Reader{ Data, Data + Size };
+	uint64_t ClassCount;
+	if (!Reader.ReadVarint(ClassCount))
+		return false;
+	for (uint64_t i = 0; i < ClassCount; i++)
+	{
+		uint32_t ClassHash;
+		uint64_t FieldCount;
+		if (!Reader.ReadFixed32(ClassHash) || !Reader.ReadVarint(FieldCount) || FieldCount > uint64_t(Reader.End - Reader.Data) / sizeof(uint32_t))
+		{
+			LOG_CATEGORY(LogReflect, ELogLevel::kWarning, "Add Peer Schema Failed, Data Is Truncated Or Corrupt");
+			return false;
+		}
+		// a new schema of the same class replace the old one, the mapping is rebuilt on the next decode
+		FReflectPeerClass& PeerClass = PeerClasses[ClassHash];
+		PeerClass.Tags.resize(size_t(FieldCount));
+		for (uint32_t& Tag : PeerClass.Tags)
+			Reader.ReadFixed32(Tag);
+		PeerClass.LocalFields.clear();
+		PeerClass.Mapped = false;
+	}
+	return true;
+}
+
+bool FReflectPeerSchema::AddSchema(FMessageData& MessageData)
+{
+	return AddSchema(MessageData.GetBody<uint8_t>(), MessageData.GetBodySize());
+}
+
+const FReflectPeerClass* FReflectPeerSchema::FindClass(const FClass* Class)
+{
+	assert(Class);
+	const FReflectSerializePlan& Plan = GetSerializePlan(Class);
+	auto It = PeerClasses.find(Plan.ClassHash);
+	if (It == PeerClasses.end())
+		return nullptr;
+	FReflectPeerClass& PeerClass = It->second;
+	if (!PeerClass.Mapped)
+	{
+		PeerClass.LocalFields.resize(PeerClass.Tags.size());
+		for (size_t i = 0; i < PeerClass.Tags.size(); i++)
+		{
+			auto FieldIt = Plan.TagToField.find(PeerClass.Tags[i]);
+			PeerClass.LocalFields[i] = FieldIt != Plan.TagToField.end() ? FieldIt->second : -1;
+		}
+		PeerClass.Mapped = true;
+	}
+	return &PeerClass;
+}
+
+void FReflectPeerSchema::Clear()
+{
+	PeerClasses.clear();
+}
@@ -0,0 +1,442 @@
+#include "Replication.h"
+#include <mutex>
+#include <memory>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include "Connection.h"
+#include "Logger.h"
+#include "BinaryEncoding.h"
+
+namespace EReplicationField
+{
+	enum Type : Uint8
+	{
+		Bool,
+		Signed,
+		Unsigned,
+		Float,
+		Double,
+		// Size bytes copied to the address of the property, enums have no setter
+		Enum,
+		String,
+	};
+}
+
+struct FReplicationField
+{
+	const FProperty* Property;
+	// address of the object the property belongs to, relative to the replicated object
+	Uint32 BaseOffset;
+	EReplicationField::Type Type;
+	Uint32 Size;
+};
+
+struct FReplicationLayout
+{
+	std::vector<FReplicationField> Fields;
+	// hash of the path, name, type, size and Number of every field, both sides must flatten the class the same way
+	uint32_t LayoutHash;
+};
+
+namespace
+{
+	bool GetFieldType(const FProperty* Property, EReplicationField::Type& OutType, Uint32& OutSize)
+	{
+		if (Property->Flag & EPF_StringFlag)
+		{
+			OutType = EReplicationField::String;
+			OutSize = sizeof(std::string);
+			return true;
+		}
+		if (Property->Flag & EPF_EnumFlag)
+		{
+			const FEnum* Enum = dynamic_cast<const FEnum*>(Property->GetMetaPropertyValue());
+			if (Enum == nullptr || Enum->Size == 0 || Enum->Size > sizeof(uint64_t))
+				return false;
+			OutType = EReplicationField::Enum;
+			OutSize = Enum->Size;
+			return true;
+		}
+		switch (Property->Flag & (EPF_BoolFlag | EPF_IntegerMaskBitFlag | EPF_FloatingPointMaskBitFlag))
+		{
+		case EPF_BoolFlag:   OutType = EReplicationField::Bool;     OutSize = sizeof(Bool);   return true;
+		case EPF_Int8Flag:   OutType = EReplicationField::Signed;   OutSize = sizeof(Int8);   return true;
+		case EPF_Int16Flag:  OutType = EReplicationField::Signed;   OutSize = sizeof(Int16);  return true;
+		case EPF_Int32Flag:  OutType = EReplicationField::Signed;   OutSize = sizeof(Int32);  return true;
+		case EPF_Int64Flag:  OutType = EReplicationField::Signed;   OutSize = sizeof(Int64);  return true;
+		case EPF_UInt8Flag:  OutType = EReplicationField::Unsigned; OutSize = sizeof(Uint8);  return true;
+		case EPF_UInt16Flag: OutType = EReplicationField::Unsigned; OutSize = sizeof(Uint16); return true;
+		case EPF_UInt32Flag: OutType = EReplicationField::Unsigned; OutSize = sizeof(Uint32); return true;
+		case EPF_UInt64Flag: OutType = EReplicationField::Unsigned; OutSize = sizeof(Uint64); return true;
+		case EPF_FloatFlag:  OutType = EReplicationField::Float;    OutSize = sizeof(Float);  return true;
+		case EPF_DoubleFlag: OutType = EReplicationField::Double;   OutSize = sizeof(Double); return true;
+		default:             return false;
+		}
+	}
+
+	// PathHash is the hash of the struct properties and element indices leading to Class
+	void CompileLayout(FReplicationLayout& Layout, const FClass* Class, Uint32 BaseOffset, uint32_t PathHash)
+	{
+		if (Class->Parent)
+			CompileLayout(Layout, Class->Parent, BaseOffset, PathHash);
+		for (const FProperty* Property : Class->Properties)
+		{
+			if (Property->Flag & (EPF_PointerFlag | EPF_ReferenceFlag | EPF_ArrayFlag | EPF_MapFlag))
+				continue;
+			if (Property->Flag & (EPF_StructFlag | EPF_ClassFlag))
+			{
+				const FClass* PropertyClass = dynamic_cast<const FClass*>(Property->GetMetaPropertyValue());
+				if (PropertyClass == nullptr)
+				{
+					LOG_CATEGORY(LogReflect, ELogLevel::kWarning, "{:s}::{:s} Has No Class, It Is Not Replicated", Class->Name, Property->Name);
+					continue;
+				}
+				uint32_t PropertyHash = HashUint32(HashString(PathHash, Property->Name), Property->Number);
+				for (Uint32 i = 0; i < Property->Number; i++)
+					CompileLayout(Layout, PropertyClass, BaseOffset + Property->Offset + i * Uint32(PropertyClass->Size), HashUint32(PropertyHash, i));
+				continue;
+			}
+			EReplicationField::Type Type;
+			Uint32 Size;
+			if (!GetFieldType(Property, Type, Size))
+			{
+				LOG_CATEGORY(LogReflect, ELogLevel::kWarning, "{:s}::{:s} Type Is Not Supported, It Is Not Replicated", Class->Name, Property->Name);
+				continue;
+			}
+			uint32_t FieldHash = HashUint32(HashUint32(HashUint32(HashString(PathHash, Property->Name), Type), Size), Property->Number);
+			Layout.LayoutHash = HashUint32(Layout.LayoutHash, FieldHash);
+			// the setters add Property->Offset, fixed array elements are addressed by moving the base
+			for (Uint32 i = 0; i < Property->Number; i++)
+				Layout.Fields.push_back(FReplicationField{ Property, BaseOffset + i * Size, Type, Size });
+		}
+	}
+
+	const FReplicationLayout& GetReplicationLayout(const FClass* Class)
+	{
+		static std::mutex Mutex;
+		static std::unordered_map<const FClass*, std::unique_ptr<FReplicationLayout>>* Layouts = new std::unordered_map<const FClass*, std::unique_ptr<FReplicationLayout>>();
+		std::lock_guard<std::mutex> Lock(Mutex);
+		std::unique_ptr<FReplicationLayout>& Layout = (*Layouts)[Class];
+		if (!Layout)
+		{
+			Layout = std::make_unique<FReplicationLayout>();
+			Layout->LayoutHash = kFnvOffsetBasis;
+			CompileLayout(*Layout, Class, 0, kFnvOffsetBasis);
+		}
+		return *Layout;
+	}
+
+	void CaptureSnapshot(const FReplicationLayout& Layout, const uint8_t* Object, std::vector<FReplicationValue>& Snapshot)
+	{
+		Snapshot.resize(Layout.Fields.size());
+		for (size_t i = 0; i < Layout.Fields.size(); i++)
+		{
+			const FReplicationField& Field = Layout.Fields[i];
+			const uint8_t* Data = Object + Field.BaseOffset;
+			FReplicationValue& Value = Snapshot[i];
+			switch (Field.Type)
+			{
+			case EReplicationField::Bool:     Value.Bits = Field.Property->GetBoolPropertyValue(Data) ? 1 : 0; break;
+			case EReplicationField::Signed:   Value.Bits = ZigZagEncode(Field.Property->GetSignedIntPropertyValue(Data)); break;
+			case EReplicationField::Unsigned: Value.Bits = Field.Property->GetUnsignedIntPropertyValue(Data); break;
+			case EReplicationField::Float:
+			{
+				float FloatValue = float(Field.Property->GetFloatingPointPropertyValue(Data));
+				uint32_t Bits;
+				memcpy(&Bits, &FloatValue, sizeof(Bits));
+				Value.Bits = Bits;
+				break;
+			}
+			case EReplicationField::Double:
+			{
+				double DoubleValue = Field.Property->GetFloatingPointPropertyValue(Data);
+				memcpy(&Value.Bits, &DoubleValue, sizeof(Value.Bits));
+				break;
+			}
+			case EReplicationField::Enum:
+				Value.Bits = 0;
+				memcpy(&Value.Bits, Data + Field.Property->Offset, Field.Size);
+				break;
+			case EReplicationField::String:   Value.String = Field.Property->GetStringPropertyValue(Data); break;
+			}
+		}
+	}
+
+	size_t GetValueSize(const FReplicationField& Field, const FReplicationValue& Value)
+	{
+		switch (Field.Type)
+		{
+		case EReplicationField::Bool:   return 1;
+		case EReplicationField::Float:  return sizeof(float);
+		case EReplicationField::Double: return sizeof(double);
+		case EReplicationField::String: return GetVarintSize(Value.String.size()) + Value.String.size();
+		default:                        return GetVarintSize(Value.Bits);
+		}
+	}
+
+	void WriteValue(FBufferWriter& Writer, const FReplicationField& Field, const FReplicationValue& Value)
+	{
+		switch (Field.Type)
+		{
+		case EReplicationField::Bool:
+			Writer.WriteByte(uint8_t(Value.Bits));
+			break;
+		case EReplicationField::Float:
+		{
+			uint32_t Bits = uint32_t(Value.Bits);
+			Writer.Write(&Bits, sizeof(Bits));
+			break;
+		}
+		case EReplicationField::Double:
+			Writer.Write(&Value.Bits, sizeof(Value.Bits));
+			break;
+		case EReplicationField::String:
+			WriteVarint(Writer, Value.String.size());
+			Writer.Write(Value.String.data(), Value.String.size());
+			break;
+		default:
+			WriteVarint(Writer, Value.Bits);
+			break;
+		}
+	}
+
+	// Object is null to only check the delta, so a corrupt delta is never partially applied
+	bool ReadValues(FReader Reader, const FReplicationLayout& Layout, const uint8_t* DirtyMask, uint8_t* Object)
+	{
+		std::string String;
+		for (size_t i = 0; i < Layout.Fields.size(); i++)
+		{
+			if ((DirtyMask[i / 8] & (1 << (i % 8))) == 0)
+				continue;
+			const FReplicationField& Field = Layout.Fields[i];
+			void* Data = Object ? Object + Field.BaseOffset : nullptr;
+			switch (Field.Type)
+			{
+			case EReplicationField::Bool:
+			{
+				uint8_t Byte;
+				if (!Reader.ReadByte(Byte))
+					return false;
+				if (Object)
+					Field.Property->SetBoolPropertyValue(Data, Byte != 0);
+				break;
+			}
+			case EReplicationField::Float:
+			{
+				float FloatValue;
+				if (!Reader.Read(&FloatValue, sizeof(FloatValue)))
+					return false;
+				if (Object)
+					Field.Property->SetFloatingPointPropertyValue(Data, double(FloatValue));
+				break;
+			}
+			case EReplicationField::Double:
+			{
+				double DoubleValue;
+				if (!Reader.Read(&DoubleValue, sizeof(DoubleValue)))
+					return false;
+				if (Object)
+					Field.Property->SetFloatingPointPropertyValue(Data, DoubleValue);
+				break;
+			}
+			case EReplicationField::String:
+			{
+				uint64_t Size;
+				if (!Reader.ReadVarint(Size) || Size > uint64_t(Reader.End - Reader.Data))
+					return false;
+				if (Object)
+				{
+					String.assign(reinterpret_cast<const char*>(Reader.Data), size_t(Size));
+					Field.Property->SetStringPropertyValue(Data, String);
+				}
+				Reader.Data += Size;
+				break;
+			}
+			default:
+			{
+				uint64_t Bits;
+				if (!Reader.ReadVarint(Bits))
+					return false;
+				if (Object == nullptr)
+					break;
+				if (Field.Type == EReplicationField::Signed)
+					Field.Property->SetIntPropertyValue(Data, Int64(ZigZagDecode(Bits)));
+				else if (Field.Type == EReplicationField::Unsigned)
+					Field.Property->SetIntPropertyValue(Data, Uint64(Bits));
+				else
+					memcpy(static_cast<uint8_t*>(Data) + Field.Property->Offset, &Bits, Field.Size);
+				break;
+			}
+			}
+		}
+		return Reader.Data == Reader.End;
+	}
+}
+
+FReplicationSender::FReplicationSender(const FClass* Class, uint32_t DataDesc)
+	: Layout(GetReplicationLayout(Class))
+	, DataDesc(DataDesc)
+{
+}
+
+uint64_t FReplicationSender::Replicate(SConnection* Connection, const void* Object)
+{
+	assert(Connection);
+	FMessageData MessageData;
+	if (!BuildDelta(Object, MessageData))
+		return 0;
+	return Connection->Send(std::move(MessageData));
+}
+
+bool FReplicationSender::BuildDelta(const void* Object, FMessageData& MessageData)
+{
+	assert(Object);
+	if (Layout.Fields.empty())
+		return false;
+	if (PendingDeltas.size() >= REPLICATION_MAX_PENDING_DELTAS)
+	{
+		LOG_CATEGORY(LogReflect, ELogLevel::kWarning, "Replication Has {:d} Deltas Not Acknowledged, Send The Whole Object", PendingDeltas.size());
+		Reset();
+	}
+	CaptureSnapshot(Layout, static_cast<const uint8_t*>(Object), CurrentSnapshot);
+
+	// changed since the acked state, or sent by a delta the peer may have applied
+	std::vector<uint64_t> DirtyMask((Layout.Fields.size() + 63) / 64, 0);
+	for (size_t i = 0; i < Layout.Fields.size(); i++)
+	{
+		if (!HasAckedSnapshot || CurrentSnapshot[i] != AckedSnapshot[i])
+			DirtyMask[i / 64] |= uint64_t(1) << (i % 64);
+	}
+	for (const FPendingDelta& PendingDelta : PendingDeltas)
+	{
+		for (size_t i = 0; i < DirtyMask.size(); i++)
+			DirtyMask[i] |= PendingDelta.DirtyMask[i];
+	}
+	bool Dirty = false;
+	for (uint64_t Word : DirtyMask)
+		Dirty |= Word != 0;
+	if (!Dirty)
+		return false;
+
+	if (++SequenceCounter == 0)
+		++SequenceCounter;
+	size_t MaskSize = (Layout.Fields.size() + 7) / 8;
+	size_t BodySize = sizeof(Layout.LayoutHash) + GetVarintSize(SequenceCounter) + MaskSize;
+	for (size_t i = 0; i < Layout.Fields.size(); i++)
+	{
+		if (DirtyMask[i / 64] & (uint64_t(1) << (i % 64)))
+			BodySize += GetValueSize(Layout.Fields[i], CurrentSnapshot[i]);
+	}
+	MessageData.SetBodySize(static_cast<uint32_t>(BodySize));
+	MessageData.SetDataDesc(DataDesc);
+	FBufferWriter Writer{ MessageData.GetBody<uint8_t>() };
+	WriteFixed32(Writer, Layout.LayoutHash);
+	WriteVarint(Writer, SequenceCounter);
+	for (size_t i = 0; i < MaskSize; i++)
+		Writer.WriteByte(uint8_t(DirtyMask[i / 8] >> (i % 8 * 8)));
+	for (size_t i = 0; i < Layout.Fields.size(); i++)
+	{
+		if (DirtyMask[i / 64] & (uint64_t(1) << (i % 64)))
+			WriteValue(Writer, Layout.Fields[i], CurrentSnapshot[i]);
+	}
+	assert(Writer.Data == MessageData.GetBody<uint8_t>() + BodySize);
+
+	PendingDeltas.push_back(FPendingDelta{ SequenceCounter, std::move(DirtyMask), CurrentSnapshot });
+	return true;
+}
+
+void FReplicationSender::Acknowledge(uint32_t Sequence)
+{
+	// acks of deltas dropped by Reset are ignored
+	for (auto It = PendingDeltas.begin(); It != PendingDeltas.end(); It++)
+	{
+		if (It->Sequence != Sequence)
+			continue;
+		AckedSnapshot = std::move(It->Snapshot);
+		HasAckedSnapshot = true;
+		PendingDeltas.erase(PendingDeltas.begin(), It + 1);
+		return;
+	}
+}
+
+bool FReplicationSender::Acknowledge(FMessageData& MessageData)
+{
+	FReader Reader{ MessageData.GetBody<uint8_t>(), MessageData.GetBody<uint8_t>() + MessageData.GetBodySize() };
+	uint64_t Sequence;
+	if (!Reader.ReadVarint(Sequence) || Sequence > UINT32_MAX)
+	{
+		LOG_CATEGORY(LogReflect, ELogLevel::kWarning, "Replication Ack Is Corrupt");
+		return false;
+	}
+	Acknowledge(uint32_t(Sequence));
+	return true;
+}
+
+void FReplicationSender::Reset()
+{
+	HasAckedSnapshot = false;
+	AckedSnapshot.clear();
+	PendingDeltas.clear();
+}
+
+FReplicationReceiver::FReplicationReceiver(const FClass* Class, uint32_t AckDataDesc)
+	: Layout(GetReplicationLayout(Class))
+	, AckDataDesc(AckDataDesc)
+{
+}
+
+bool FReplicationReceiver::Apply(void* Object, const uint8_t* Data, size_t Size)
+{
+	assert(Object);
+	FReader Reader{ Data, Data + Size };
+	uint32_t LayoutHash;
+	uint64_t Sequence;
+	size_t MaskSize = (Layout.Fields.size() + 7) / 8;
+	if (!Reader.ReadFixed32(LayoutHash) || LayoutHash != Layout.LayoutHash)
+	{
+		LOG_CATEGORY(LogReflect, ELogLevel::kWarning, "Replication Delta Is Not Of This Layout");
+		return false;
+	}
+	if (!Reader.ReadVarint(Sequence) || Sequence > UINT32_MAX || size_t(Reader.End - Reader.Data) < MaskSize)
+	{
+		LOG_CATEGORY(LogReflect, ELogLevel::kWarning, "Replication Delta Is Truncated Or Corrupt");
+		return false;
+	}
+	const uint8_t* DirtyMask = Reader.Data;
+	Reader.Data += MaskSize;
+	if (!ReadValues(Reader, Layout, DirtyMask, nullptr))
+	{
+		LOG_CATEGORY(LogReflect, ELogLevel::kWarning, "Replication Delta Is Truncated Or Corrupt");
+		return false;
+	}
+	ReadValues(Reader, Layout, DirtyMask, static_cast<uint8_t*>(Object));
+	LastAppliedSequence = uint32_t(Sequence);
+	return true;
+}
+
+bool FReplicationReceiver::Apply(void* Object, FMessageData& MessageData)
+{
+	return Apply(Object, MessageData.GetBody<uint8_t>(), MessageData.GetBodySize());
+}
+
+bool FReplicationReceiver::BuildAck(FMessageData& MessageData)
+{
+	if (LastAppliedSequence == LastAckedSequence)
+		return false;
+	MessageData.SetBodySize(static_cast<uint32_t>(GetVarintSize(LastAppliedSequence)));
+	MessageData.SetDataDesc(AckDataDesc);
+	FBufferWriter Writer{ MessageData.GetBody<uint8_t>() };
+	WriteVarint(Writer, LastAppliedSequence);
+	LastAckedSequence = LastAppliedSequence;
+	return true;
+}
+
+uint64_t FReplicationReceiver::SendAck(SConnection* Connection)
+{
+	assert(Connection);
+	FMessageData MessageData;
+	if (!BuildAck(MessageData))
+		return 0;
+	return Connection->Send(std::move(MessageData));
+}
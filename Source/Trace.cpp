@@ -0,0 +1,180 @@
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <format>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+std::atomic<bool> FTrace::Enabled{ false };
+
+namespace
+{
+	struct FTraceThreadBuffer
+	{
+		FTraceThreadBuffer(uint32_t ThreadId)
+			: ThreadId(ThreadId)
+		{
+		}
+
+		// written by the owner thread only, allocated by the first recorded event
+		std::unique_ptr<FTraceEvent[]> Events;
+		std::atomic<uint64_t> WriteIndex{ 0 };
+		// events before this index were cleared
+		std::atomic<uint64_t> ClearIndex{ 0 };
+		uint32_t ThreadId;
+		std::string ThreadName;
+	};
+
+	struct FTraceRegistry
+	{
+		std::mutex Mutex;
+		// buffers of exited threads are kept until Clear
+		std::vector<std::shared_ptr<FTraceThreadBuffer>> ThreadBuffers;
+		uint32_t ThreadIdCounter{ 0 };
+	};
+
+	FTraceRegistry& GetTraceRegistry()
+	{
+		static FTraceRegistry* TraceRegistry = new FTraceRegistry();
+		return *TraceRegistry;
+	}
+
+	thread_local std::shared_ptr<FTraceThreadBuffer> GTraceThreadBuffer;
+
+	FTraceThreadBuffer& GetTraceThreadBuffer()
+	{
+		if (!GTraceThreadBuffer)
+		{
+			FTraceRegistry& Registry = GetTraceRegistry();
+			std::lock_guard<std::mutex> Lock(Registry.Mutex);
+			GTraceThreadBuffer = std::make_shared<FTraceThreadBuffer>(++Registry.ThreadIdCounter);
+			GTraceThreadBuffer->ThreadName = std::format("Thread {:d}", GTraceThreadBuffer->ThreadId);
+			Registry.ThreadBuffers.push_back(GTraceThreadBuffer);
+		}
+		return *GTraceThreadBuffer;
+	}
+
+	// the owner thread may be writing the slot of WriteIndex, which is also the slot of WriteIndex - capacity
+	uint64_t GetOldestIntactIndex(uint64_t WriteIndex)
+	{
+		return WriteIndex >= TRACE_THREAD_BUFFER_CAPACITY ? WriteIndex - TRACE_THREAD_BUFFER_CAPACITY + 1 : 0;
+	}
+
+	void AppendJsonString(std::string& Json, const char* String)
+	{
+		Json.push_back('"');
+		for (const char* It = String; *It; It++)
+		{
+			if (*It == '"' || *It == '\\')
+				Json.push_back('\\');
+			Json.push_back(*It);
+		}
+		Json.push_back('"');
+	}
+}
+
+void FTrace::Start()
+{
+	Enabled.store(true, std::memory_order_relaxed);
+}
+
+void FTrace::Stop()
+{
+	Enabled.store(false, std::memory_order_relaxed);
+}
+
+void FTrace::Record(ETracePhase::Type Phase, const char* Name, const char* Category, int64_t Value)
+{
+	FTraceThreadBuffer& ThreadBuffer = GetTraceThreadBuffer();
+	// readers only touch the events below WriteIndex, published after the allocation
+	if (!ThreadBuffer.Events)
+		ThreadBuffer.Events = std::make_unique<FTraceEvent[]>(TRACE_THREAD_BUFFER_CAPACITY);
+	uint64_t WriteIndex = ThreadBuffer.WriteIndex.load(std::memory_order_relaxed);
+	FTraceEvent& Event = ThreadBuffer.Events[WriteIndex & (TRACE_THREAD_BUFFER_CAPACITY - 1)];
+	Event.Timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+	Event.Name = Name;
+	Event.Category = Category;
+	Event.Value = Value;
+	Event.Phase = Phase;
+	ThreadBuffer.WriteIndex.store(WriteIndex + 1, std::memory_order_release);
+}
+
+void FTrace::SetThreadName(const std::string& ThreadName)
+{
+	FTraceThreadBuffer& ThreadBuffer = GetTraceThreadBuffer();
+	std::lock_guard<std::mutex> Lock(GetTraceRegistry().Mutex);
+	ThreadBuffer.ThreadName = ThreadName;
+}
+
+std::string FTrace::ToChromeTrace()
+{
+	static_assert((TRACE_THREAD_BUFFER_CAPACITY & (TRACE_THREAD_BUFFER_CAPACITY - 1)) == 0, "TRACE_THREAD_BUFFER_CAPACITY must be a power of two");
+	FTraceRegistry& Registry = GetTraceRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	std::string Json = "{\"traceEvents\":[\n";
+	bool First = true;
+	std::vector<FTraceEvent> Events;
+	for (auto& ThreadBuffer : Registry.ThreadBuffers)
+	{
+		if (!First) Json.append(",\n");
+		First = false;
+		Json.append(std::format("{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":{:d},\"args\":{{\"name\":", ThreadBuffer->ThreadId));
+		AppendJsonString(Json, ThreadBuffer->ThreadName.c_str());
+		Json.append("}}");
+
+		// copy then drop what the owner thread may have overwritten during the copy
+		uint64_t WriteIndex = ThreadBuffer->WriteIndex.load(std::memory_order_acquire);
+		uint64_t BeginIndex = (std::max)(ThreadBuffer->ClearIndex.load(std::memory_order_relaxed), GetOldestIntactIndex(WriteIndex));
+		Events.clear();
+		for (uint64_t i = BeginIndex; i < WriteIndex; i++)
+			Events.push_back(ThreadBuffer->Events[i & (TRACE_THREAD_BUFFER_CAPACITY - 1)]);
+		uint64_t OverwrittenIndex = GetOldestIntactIndex(ThreadBuffer->WriteIndex.load(std::memory_order_acquire));
+		size_t Skip = OverwrittenIndex > BeginIndex ? size_t((std::min)(OverwrittenIndex - BeginIndex, uint64_t(Events.size()))) : 0;
+
+		for (size_t i = Skip; i < Events.size(); i++)
+		{
+			const FTraceEvent& Event = Events[i];
+			Json.append(",\n{\"name\":");
+			AppendJsonString(Json, Event.Name);
+			Json.append(",\"cat\":");
+			AppendJsonString(Json, Event.Category);
+			Json.append(std::format(",\"ph\":\"{:c}\",\"ts\":{:.3f},\"pid\":1,\"tid\":{:d}", char(Event.Phase), Event.Timestamp / 1000.0, ThreadBuffer->ThreadId));
+			if (Event.Phase == ETracePhase::Counter)
+				Json.append(std::format(",\"args\":{{\"value\":{:d}}}", Event.Value));
+			else if (Event.Phase == ETracePhase::Instant)
+				Json.append(",\"s\":\"t\"");
+			Json.push_back('}');
+		}
+	}
+	Json.append("\n]}\n");
+	return Json;
+}
+
+bool FTrace::WriteChromeTrace(const std::string& Path)
+{
+	std::string Json = ToChromeTrace();
+	std::ofstream File(Path, std::ios::binary | std::ios::trunc);
+	if (!File)
+		return false;
+	File.write(Json.data(), Json.size());
+	return bool(File);
+}
+
+void FTrace::Clear()
+{
+	FTraceRegistry& Registry = GetTraceRegistry();
+	std::lock_guard<std::mutex> Lock(Registry.Mutex);
+	for (auto It = Registry.ThreadBuffers.begin(); It != Registry.ThreadBuffers.end();)
+	{
+		// only the registry and the thread local hold live buffers
+		if (It->use_count() == 1)
+		{
+			It = Registry.ThreadBuffers.erase(It);
+			continue;
+		}
+		(*It)->ClearIndex.store((*It)->WriteIndex.load(std::memory_order_acquire), std::memory_order_relaxed);
+		It++;
+	}
+}
@@ -0,0 +1,232 @@
+#include "Logger.h"
+#include "Network.h"
+#include "Core.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+// usage:
+// BenchNetwork [--sizes 16,256,4096,65536,1048576] [--connections 1,16,256] [--threads 1,4]
+//              [--messages 1000] [--window 8] [--port 1091] [--sharded]
+// every configuration print one json line to stdout:
+// {"size":16,"connections":1,"threads":1,"sharded":false,"messages":1000,"seconds":...,"msgs_per_sec":...,
+//  "bytes_per_sec":...,"p50_us":...,"p99_us":...,"p999_us":...}
+
+struct FBenchConfig
+{
+	std::vector<uint32_t> Sizes{ 16, 256, 4096, 65536, 1048576 };
+	std::vector<uint32_t> Connections{ 1, 16, 256 };
+	std::vector<uint32_t> Threads{ 1, 4 };
+	// round trips per connection
+	uint32_t Messages{ 1000 };
+	// messages in flight per connection
+	uint32_t Window{ 8 };
+	uint16_t Port{ 1091 };
+	bool Sharded{ false };
+};
+
+uint64_t NowNanoseconds()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::vector<uint32_t> ParseList(const char* Text)
+{
+	std::vector<uint32_t> List;
+	std::string Token;
+	for (const char* It = Text; ; It++)
+	{
+		if (*It == ',' || *It == '\0')
+		{
+			if (!Token.empty()) List.push_back(static_cast<uint32_t>(std::stoul(Token)));
+			Token.clear();
+			if (*It == '\0') break;
+		}
+		else
+		{
+			Token.push_back(*It);
+		}
+	}
+	return List;
+}
+
+class CBenchEchoServer : public CServer
+{
+public:
+	CBenchEchoServer(uint32_t ThreadNumber, EIoContextMode IoContextMode)
+		: CServer(ThreadNumber, IoContextMode)
+	{
+	}
+
+	void OnMessage(std::shared_ptr<SConnection> ConnectionPtr, FMessageData& MessageData) override
+	{
+		ConnectionPtr->Send(std::move(MessageData));
+	}
+};
+
+class CBenchClient : public CClient
+{
+public:
+	CBenchClient(uint32_t ThreadNumber, EIoContextMode IoContextMode, uint32_t MessageSize, uint32_t MessagesPerConnection)
+		: CClient(ThreadNumber, IoContextMode)
+		, MessageSize(MessageSize)
+		, MessagesPerConnection(MessagesPerConnection)
+	{
+	}
+
+	void SendTimestamped(const std::shared_ptr<SConnection>& ConnectionPtr)
+	{
+		FMessageData MessageData;
+		MessageData.SetBodySize(MessageSize);
+		uint64_t Timestamp = NowNanoseconds();
+		memcpy(MessageData.GetBody<void>(), &Timestamp, sizeof(Timestamp));
+		ConnectionPtr->Send(std::move(MessageData));
+		SentCounter[ConnectionPtr.get()]++;
+	}
+
+	void OnMessage(std::shared_ptr<SConnection> ConnectionPtr, FMessageData& MessageData) override
+	{
+		uint64_t Timestamp;
+		memcpy(&Timestamp, MessageData.GetBody<void>(), sizeof(Timestamp));
+		RoundTripNanoseconds.push_back(NowNanoseconds() - Timestamp);
+		if (SentCounter[ConnectionPtr.get()] < MessagesPerConnection)
+			SendTimestamped(ConnectionPtr);
+	}
+
+	uint32_t MessageSize;
+	uint32_t MessagesPerConnection;
+	std::unordered_map<SConnection*, uint32_t> SentCounter;
+	std::vector<uint64_t> RoundTripNanoseconds;
+};
+
+double Percentile(const std::vector<uint64_t>& Sorted, double P)
+{
+	if (Sorted.empty()) return 0.0;
+	size_t Index = static_cast<size_t>(P * (Sorted.size() - 1));
+	return Sorted[Index] / 1000.0;
+}
+
+bool RunBench(const FBenchConfig& Config, uint32_t MessageSize, uint32_t NumConnections, uint32_t NumThreads, uint16_t Port)
+{
+	EIoContextMode IoContextMode = Config.Sharded ? EIoContextMode::Sharded : EIoContextMode::Shared;
+	std::atomic<bool> ServerReady{ false };
+	std::atomic<bool> ServerRunning{ true };
+	std::thread ServerThread([&] {
+		CBenchEchoServer Server(NumThreads, IoContextMode);
+		Server.Run(Port, Config.Sharded ? 0 : 1);
+		ServerReady = true;
+		while (ServerRunning)
+		{
+			if (Server.ProcessMessage(256) == 0)
+			{
+				Server.ProcessTask();
+				std::this_thread::yield();
+			}
+		}
+		});
+	while (!ServerReady) std::this_thread::yield();
+
+	bool Success = true;
+	uint64_t TotalMessages = uint64_t(NumConnections) * Config.Messages;
+	double Seconds = 0.0;
+	std::vector<uint64_t> RoundTripNanoseconds;
+	{
+		CBenchClient Client(NumThreads, IoContextMode, (std::max)(MessageSize, uint32_t(sizeof(uint64_t))), Config.Messages);
+		Client.RoundTripNanoseconds.reserve(TotalMessages);
+		std::vector<std::future<std::shared_ptr<SConnection>>> FutureConnections;
+		std::vector<std::shared_ptr<SConnection>> Connections;
+		for (uint32_t i = 0; i < NumConnections; i++)
+			FutureConnections.push_back(Client.ConnectToServer("127.0.0.1", Port));
+		for (auto& FutureConnection : FutureConnections)
+		{
+			while (FutureConnection.wait_for(std::chrono::milliseconds(1)) != std::future_status::ready)
+				Client.ProcessEvent();
+			std::shared_ptr<SConnection> Connection = FutureConnection.get();
+			if (!Connection || Connection->GetSocketState() != ESocketState::Connected)
+			{
+				Success = false;
+				break;
+			}
+			Connections.push_back(Connection);
+		}
+
+		if (Success)
+		{
+			uint64_t Start = NowNanoseconds();
+			for (auto& Connection : Connections)
+			{
+				for (uint32_t i = 0; i < (std::min)(Config.Window, Config.Messages); i++)
+					Client.SendTimestamped(Connection);
+			}
+			while (Client.RoundTripNanoseconds.size() < TotalMessages)
+			{
+				if (Client.ProcessMessage(256) == 0)
+				{
+					Client.ProcessTask();
+					std::this_thread::yield();
+				}
+			}
+			Seconds = (NowNanoseconds() - Start) / 1e9;
+			RoundTripNanoseconds = std::move(Client.RoundTripNanoseconds);
+		}
+		Connections.clear();
+	}
+	ServerRunning = false;
+	ServerThread.join();
+
+	if (!Success)
+	{
+		std::fprintf(stderr, "connect failed, size %u connections %u threads %u\n", MessageSize, NumConnections, NumThreads);
+		return false;
+	}
+
+	std::sort(RoundTripNanoseconds.begin(), RoundTripNanoseconds.end());
+	uint64_t FrameSize = MessageSize + sizeof(FMessageData::FHeader);
+	std::printf("{\"size\":%u,\"connections\":%u,\"threads\":%u,\"sharded\":%s,\"messages\":%llu,\"seconds\":%.6f,"
+		"\"msgs_per_sec\":%.1f,\"bytes_per_sec\":%.1f,\"p50_us\":%.3f,\"p99_us\":%.3f,\"p999_us\":%.3f}\n",
+		MessageSize, NumConnections, NumThreads, Config.Sharded ? "true" : "false",
+		(unsigned long long)TotalMessages, Seconds,
+		TotalMessages / Seconds, TotalMessages * FrameSize * 2 / Seconds,
+		Percentile(RoundTripNanoseconds, 0.50), Percentile(RoundTripNanoseconds, 0.99), Percentile(RoundTripNanoseconds, 0.999));
+	std::fflush(stdout);
+	return true;
+}
+
+int main(int argc, const char* argv[])
+{
+	FBenchConfig Config;
+	for (int i = 1; i < argc; i++)
+	{
+		std::string Arg = argv[i];
+		bool HasValue = i + 1 < argc;
+		if (Arg == "--sizes" && HasValue) Config.Sizes = ParseList(argv[++i]);
+		else if (Arg == "--connections" && HasValue) Config.Connections = ParseList(argv[++i]);
+		else if (Arg == "--threads" && HasValue) Config.Threads = ParseList(argv[++i]);
+		else if (Arg == "--messages" && HasValue) Config.Messages = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (Arg == "--window" && HasValue) Config.Window = static_cast<uint32_t>(std::stoul(argv[++i]));
+		else if (Arg == "--port" && HasValue) Config.Port = static_cast<uint16_t>(std::stoul(argv[++i]));
+		else if (Arg == "--sharded") Config.Sharded = true;
+		else
+		{
+			std::fprintf(stderr, "unknown argument %s\n", Arg.c_str());
+			return 1;
+		}
+	}
+
+	CoreInitialize();
+	int ExitCode = 0;
+	uint16_t Port = Config.Port;
+	for (uint32_t NumThreads : Config.Threads)
+		for (uint32_t NumConnections : Config.Connections)
+			for (uint32_t MessageSize : Config.Sizes)
+				if (!RunBench(Config, MessageSize, NumConnections, NumThreads, Port++))
+					ExitCode = 1;
+	CoreUninitialize();
+	return ExitCode;
+}
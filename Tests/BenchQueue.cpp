@@ -0,0 +1,134 @@
+#include "Queue.h"
+#include "RingQueue.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+std::atomic<uint64_t> GAllocationCounter{ 0 };
+
+void* operator new(std::size_t Size)
+{
+	GAllocationCounter.fetch_add(1, std::memory_order_relaxed);
+	if (void* Ptr = std::malloc(Size ? Size : 1))
+		return Ptr;
+	throw std::bad_alloc();
+}
+
+void operator delete(void* Ptr) noexcept { std::free(Ptr); }
+void operator delete(void* Ptr, std::size_t) noexcept { std::free(Ptr); }
+
+constexpr uint64_t BenchWarmupCounter = 1 << 16;
+constexpr uint64_t BenchOperationCounter = 1 << 22;
+constexpr uint32_t BenchProducerCounter = 4;
+
+struct FBenchResult
+{
+	double NanosecondsPerOperation;
+	double AllocationsPerOperation;
+};
+
+template<typename TQueueType>
+FBenchResult BenchSingleThread(TQueueType& Queue)
+{
+	uint64_t Element = 0;
+	// warmup fill the node pool
+	for (uint64_t i = 0; i < BenchWarmupCounter; i++) Queue.Enqueue(i);
+	while (Queue.Dequeue(Element));
+
+	uint64_t AllocationStart = GAllocationCounter.load();
+	auto Start = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < BenchOperationCounter; i++)
+	{
+		Queue.Enqueue(i);
+		Queue.Dequeue(Element);
+	}
+	auto End = std::chrono::steady_clock::now();
+	uint64_t AllocationEnd = GAllocationCounter.load();
+	return FBenchResult{
+		std::chrono::duration<double, std::nano>(End - Start).count() / BenchOperationCounter,
+		double(AllocationEnd - AllocationStart) / BenchOperationCounter };
+}
+
+template<typename TQueueType>
+FBenchResult BenchMultiProducer(TQueueType& Queue)
+{
+	uint64_t Element = 0;
+	for (uint64_t i = 0; i < BenchWarmupCounter; i++) Queue.Enqueue(i);
+	while (Queue.Dequeue(Element));
+
+	std::vector<std::thread> Producers;
+	Producers.reserve(BenchProducerCounter);
+	uint64_t AllocationStart = GAllocationCounter.load();
+	auto Start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < BenchProducerCounter; i++)
+	{
+		Producers.emplace_back([&Queue] {
+			for (uint64_t j = 0; j < BenchOperationCounter / BenchProducerCounter; j++)
+				Queue.Enqueue(j);
+			});
+	}
+	uint64_t DequeueCounter = 0;
+	while (DequeueCounter < BenchOperationCounter)
+	{
+		if (Queue.Dequeue(Element)) DequeueCounter++;
+	}
+	auto End = std::chrono::steady_clock::now();
+	uint64_t AllocationEnd = GAllocationCounter.load();
+	for (auto& Producer : Producers) Producer.join();
+	// thread creation allocations are not part of the queue cost
+	uint64_t Allocations = AllocationEnd - AllocationStart;
+	Allocations = Allocations > BenchProducerCounter * 2 ? Allocations - BenchProducerCounter * 2 : 0;
+	return FBenchResult{
+		std::chrono::duration<double, std::nano>(End - Start).count() / BenchOperationCounter,
+		double(Allocations) / BenchOperationCounter };
+}
+
+void PrintResult(const char* Name, const FBenchResult& Result)
+{
+	std::printf("%-28s %10.2f ns/op %10.4f allocs/op\n", Name, Result.NanosecondsPerOperation, Result.AllocationsPerOperation);
+}
+
+int main()
+{
+	{
+		TQueue<uint64_t, EQueueMode::SPSC> Queue;
+		PrintResult("SPSC Heap", BenchSingleThread(Queue));
+	}
+	{
+		TQueue<uint64_t, EQueueMode::SPSC, EQueueNodeAllocator::Pool> Queue(BenchWarmupCounter);
+		PrintResult("SPSC Pool", BenchSingleThread(Queue));
+	}
+	{
+		TQueue<uint64_t, EQueueMode::MPSC> Queue;
+		PrintResult("MPSC Heap", BenchSingleThread(Queue));
+	}
+	{
+		TQueue<uint64_t, EQueueMode::MPSC, EQueueNodeAllocator::Pool> Queue(BenchWarmupCounter);
+		PrintResult("MPSC Pool", BenchSingleThread(Queue));
+	}
+	{
+		TQueue<uint64_t, EQueueMode::MPSC> Queue;
+		PrintResult("MPSC Heap 4 producers", BenchMultiProducer(Queue));
+	}
+	{
+		TQueue<uint64_t, EQueueMode::MPSC, EQueueNodeAllocator::Pool> Queue(BenchOperationCounter);
+		PrintResult("MPSC Pool 4 producers", BenchMultiProducer(Queue));
+	}
+	{
+		TRingQueue<uint64_t, EQueueMode::SPSC> Queue(BenchWarmupCounter);
+		PrintResult("SPSC Ring", BenchSingleThread(Queue));
+	}
+	{
+		TRingQueue<uint64_t, EQueueMode::MPSC> Queue(BenchWarmupCounter);
+		PrintResult("MPSC Ring", BenchSingleThread(Queue));
+	}
+	{
+		TRingQueue<uint64_t, EQueueMode::MPMC> Queue(BenchWarmupCounter);
+		PrintResult("MPMC Ring", BenchSingleThread(Queue));
+	}
+}
@@ -0,0 +1,74 @@
+#include "LogFileSink.h"
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// usage: LogDecoder <segment.clog>...
+// print every record of the binary log segments written by CLogFileSink as text
+
+bool DecodeSegment(const char* Path)
+{
+	std::ifstream File(Path, std::ios::binary);
+	if (!File)
+	{
+		std::fprintf(stderr, "open %s failed\n", Path);
+		return false;
+	}
+	std::vector<char> Data((std::istreambuf_iterator<char>(File)), std::istreambuf_iterator<char>());
+	FLogFileHeader FileHeader;
+	if (Data.size() < sizeof(FileHeader))
+	{
+		std::fprintf(stderr, "%s is not a log segment\n", Path);
+		return false;
+	}
+	memcpy(&FileHeader, Data.data(), sizeof(FileHeader));
+	if (FileHeader.Magic != LOG_FILE_MAGIC || FileHeader.Version != LOG_FILE_VERSION)
+	{
+		std::fprintf(stderr, "%s is not a log segment or has an unsupported version\n", Path);
+		return false;
+	}
+	std::string Line;
+	size_t Offset = sizeof(FileHeader);
+	while (Offset + sizeof(FLogFileRecord) <= Data.size())
+	{
+		FLogFileRecord FileRecord;
+		memcpy(&FileRecord, Data.data() + Offset, sizeof(FileRecord));
+		if (FileRecord.RecordSize == 0)
+			break;
+		if (FileRecord.RecordSize < sizeof(FileRecord) + FileRecord.MessageSize || Offset + FileRecord.RecordSize > Data.size())
+		{
+			std::fprintf(stderr, "%s truncated record at offset %zu\n", Path, Offset);
+			return false;
+		}
+		time_t Seconds = time_t(FileRecord.Timestamp / 1000000000);
+		Line = std::format("[{:s}.{:09d}] [{:#010x}] [{:<7s}] ",
+			FormatSystemTime(Seconds),
+			FileRecord.Timestamp % 1000000000,
+			FileRecord.ThreadId,
+			ToString(ELogLevel(FileRecord.LogLevel)));
+		Line.append(Data.data() + Offset + sizeof(FileRecord), FileRecord.MessageSize);
+		Line.push_back('\n');
+		std::fwrite(Line.data(), 1, Line.size(), stdout);
+		Offset += FileRecord.RecordSize;
+	}
+	return true;
+}
+
+int main(int argc, const char* argv[])
+{
+	if (argc < 2)
+	{
+		std::fprintf(stderr, "usage: LogDecoder <segment%s>...\n", LOG_FILE_EXTENSION);
+		return 1;
+	}
+	int ExitCode = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (!DecodeSegment(argv[i]))
+			ExitCode = 1;
+	}
+	return ExitCode;
+}
@@ -0,0 +1,70 @@
+#include "LogScopeTime.h"
+#include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+static const FLogScopeTimeStat* FindStat(const std::vector<FLogScopeTimeStat>& Stats, const char* Name)
+{
+	for (const FLogScopeTimeStat& Stat : Stats)
+	{
+		if (strcmp(Stat.Name, Name) == 0)
+			return &Stat;
+	}
+	return nullptr;
+}
+
+// the histogram keep about 6% of relative error
+static bool IsNear(uint64_t Value, uint64_t Expected)
+{
+	return double(Value) >= double(Expected) * 0.9375 && double(Value) <= double(Expected) * 1.0625;
+}
+
+int main()
+{
+	static const FLogScopeTimeSite SmallSite("Small", __FILE__, __LINE__);
+	static const FLogScopeTimeSite LinearSite("Linear", __FILE__, __LINE__);
+	static const FLogScopeTimeSite MergedSite("Merged", __FILE__, __LINE__);
+	static const FLogScopeTimeSite UnusedSite("Unused", __FILE__, __LINE__);
+
+	// values below 16 nanoseconds have their own bucket
+	for (uint64_t i = 1; i <= 10; i++)
+		FLogScopeTimeProfiler::Record(SmallSite, i);
+	// 1us to 1ms
+	uint64_t LinearTotal = 0;
+	for (uint64_t i = 1; i <= 1000; i++)
+	{
+		FLogScopeTimeProfiler::Record(LinearSite, i * 1000);
+		LinearTotal += i * 1000;
+	}
+	// half recorded by a thread which exits before the stats are collected
+	std::thread Thread([] {
+		for (uint64_t i = 0; i < 100; i++)
+			FLogScopeTimeProfiler::Record(MergedSite, 100);
+		});
+	Thread.join();
+	for (uint64_t i = 0; i < 100; i++)
+		FLogScopeTimeProfiler::Record(MergedSite, 1000000);
+
+	std::vector<FLogScopeTimeStat> Stats = FLogScopeTimeProfiler::CollectStats();
+	assert(FindStat(Stats, "Unused") == nullptr);
+
+	const FLogScopeTimeStat* Small = FindStat(Stats, "Small");
+	assert(Small && Small->Count == 10 && Small->Total == 55 && Small->Max == 10);
+	assert(Small->P50 == 5 && Small->P99 == 10);
+
+	const FLogScopeTimeStat* Linear = FindStat(Stats, "Linear");
+	assert(Linear && Linear->Count == 1000 && Linear->Total == LinearTotal && Linear->Max == 1000000);
+	assert(IsNear(Linear->P50, 500000) && IsNear(Linear->P99, 990000));
+
+	const FLogScopeTimeStat* Merged = FindStat(Stats, "Merged");
+	assert(Merged && Merged->Count == 200 && Merged->Max == 1000000);
+	assert(IsNear(Merged->P50, 100) && IsNear(Merged->P99, 1000000));
+
+	// retired records are kept by the next collect
+	Stats = FLogScopeTimeProfiler::CollectStats();
+	Merged = FindStat(Stats, "Merged");
+	assert(Merged && Merged->Count == 200);
+	printf("%s", FLogScopeTimeProfiler::DumpText().c_str());
+	return 0;
+}
@@ -1,5 +1,25 @@
 #include "Logger.h"
 #include <cassert>
+
+// keep the messages, log Reentrant more messages from the logger thread on the next write
+struct FCaptureSink : public ILogSink
+{
+	void Write(const FLogRecordHeader& Record, std::string_view Message) override
+	{
+		Messages.emplace_back(Message);
+		Timestamps.push_back(Record.Timestamp);
+		uint32_t Count = Reentrant;
+		Reentrant = 0;
+		for (uint32_t i = 0; i < Count; i++)
+			Logger->Log(ELogLevel::kInfo, std::format("sink {:d}", i));
+	}
+
+	CLogger* Logger{ nullptr };
+	uint32_t Reentrant{ 0 };
+	std::vector<std::string> Messages;
+	std::vector<int64_t> Timestamps;
+};
+
 int main()
 {
 	std::unordered_map<FLogMessage, std::list<time_t>> LogHashMap;
@@ -22,8 +42,64 @@ int main()
 	{
 		ts[i].join();
 	}
-}
-
 
+	// a sink logging more than its buffer hold must not wait for the logger thread, which is itself
+	std::shared_ptr<FCaptureSink> Sink = std::make_shared<FCaptureSink>();
+	{
+		CLogger SinkLogger;
+		SinkLogger.SetConsoleOutput(false);
+		Sink->Logger = &SinkLogger;
+		Sink->Reentrant = LOG_THREAD_BUFFER_CAPACITY * 2;
+		SinkLogger.AddLogSink(Sink).wait();
+		SinkLogger.Log(ELogLevel::kInfo, "start");
+	}
+	uint32_t Dropped = 0;
+	uint32_t Written = 0;
+	for (const std::string& Message : Sink->Messages)
+	{
+		Written += Message.starts_with("sink ");
+		sscanf(Message.c_str(), "logger thread buffer full, dropped %u", &Dropped);
+	}
+	assert(Dropped != 0 && Written + Dropped == LOG_THREAD_BUFFER_CAPACITY * 2);
 
+	// repeats inside the dedup window are summarized, deferred logs repeat by call site whatever their arguments
+	Sink = std::make_shared<FCaptureSink>();
+	{
+		CLogger DedupLogger;
+		DedupLogger.SetConsoleOutput(false);
+		FLogSuppressionConfig SuppressionConfig;
+		SuppressionConfig.DedupWindowMilliseconds = 60000;
+		DedupLogger.SetSuppressionConfig(SuppressionConfig);
+		// tasks run in order, the config is applied once the sink is added
+		DedupLogger.AddLogSink(Sink).wait();
+		for (uint32_t i = 0; i < 5; i++)
+			DedupLogger.Log(ELogLevel::kInfo, "same");
+		for (uint32_t i = 0; i < 3; i++)
+			DedupLogger.LogDeferred(ELogLevel::kWarning, [] { return "<{:s}> Socket Error\n"; }, std::to_string(i));
+	}
+	assert(Sink->Messages.size() == 4);
+	assert(std::count(Sink->Messages.begin(), Sink->Messages.end(), "same") == 1);
+	assert(std::count(Sink->Messages.begin(), Sink->Messages.end(), "same [repeated 4 times]") == 1);
+	assert(std::count(Sink->Messages.begin(), Sink->Messages.end(), "<0> Socket Error") == 1);
+	assert(std::count(Sink->Messages.begin(), Sink->Messages.end(), "<{:s}> Socket Error [repeated 2 times]") == 1);
 
+	// the rate limit let the burst through and report the drops of the call site
+	Sink = std::make_shared<FCaptureSink>();
+	{
+		CLogger RateLimitLogger;
+		RateLimitLogger.SetConsoleOutput(false);
+		FLogSuppressionConfig SuppressionConfig;
+		SuppressionConfig.RateLimitPerSecond = 1;
+		SuppressionConfig.RateLimitBurst = 2;
+		RateLimitLogger.SetSuppressionConfig(SuppressionConfig);
+		RateLimitLogger.AddLogSink(Sink).wait();
+		for (uint32_t i = 0; i < 10; i++)
+			RateLimitLogger.LogDeferred(ELogLevel::kInfo, [] { return "limited {:d}"; }, i);
+	}
+	assert(Sink->Messages.size() == 3);
+	assert(Sink->Messages[0] == "limited 0" && Sink->Messages[1] == "limited 1");
+	assert(Sink->Messages[2] == "rate limit dropped 8 messages of \"limited {:d}\"");
+	// the summary flushed at shutdown carry the current time
+	int64_t SummaryAge = FLogClock::Now() - Sink->Timestamps[2];
+	assert(SummaryAge >= 0 && SummaryAge < 10 * int64_t(1000000000));
+}
@@ -0,0 +1,132 @@
+#include "NameMap.h"
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// keys of a map with InternKeys false must outlive the map
+static const char* CollidingNames[] = { "A", "B", "C", "D", "E", "F" };
+
+int main()
+{
+	// growth past 8, 16, ... entries keep every name
+	{
+		TNameMap<uint32_t> Map;
+		for (uint32_t i = 0; i < 1000; i++)
+		{
+			bool Inserted = Map.Insert("Name" + std::to_string(i), i);
+			assert(Inserted);
+			if ((i & (i + 1)) == 0 || i % 8 == 7)
+			{
+				assert(Map.Num() == i + 1);
+				for (uint32_t j = 0; j <= i; j++)
+				{
+					const uint32_t* Value = Map.Find("Name" + std::to_string(j));
+					assert(Value && *Value == j);
+				}
+			}
+		}
+		bool Reinserted = Map.Insert("Name7", 0);
+		assert(!Reinserted && *Map.Find("Name7") == 7);
+		assert(Map.Find("Name1000") == nullptr);
+	}
+
+	// hashes chosen to share home slots with 8 and 16 slots, 31 and 47 collide on the last slot and wrap around
+	{
+		TNameMap<uint32_t, false> Map;
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			FNameKey Key(CollidingNames[i]);
+			Key.Hash = i < 3 ? 8 * (i + 1) : 7 + 8 * i;
+			bool IsNew;
+			Map.FindOrAdd(Key, IsNew) = i;
+			assert(IsNew);
+		}
+		// a full hash collision only differ by the name
+		FNameKey Same("Z");
+		Same.Hash = 8;
+		bool IsNew;
+		Map.FindOrAdd(Same, IsNew) = 100;
+		assert(IsNew && Map.Num() == 7);
+		for (uint32_t i = 0; i < 6; i++)
+		{
+			FNameKey Key(CollidingNames[i]);
+			Key.Hash = i < 3 ? 8 * (i + 1) : 7 + 8 * i;
+			const uint32_t* Value = Map.Find(Key);
+			assert(Value && *Value == i);
+			Map.FindOrAdd(Key, IsNew);
+			assert(!IsNew);
+		}
+		assert(*Map.Find(Same) == 100);
+		FNameKey Missing("Y");
+		Missing.Hash = 8;
+		assert(Map.Find(Missing) == nullptr);
+	}
+
+	// unordered_map style members
+	{
+		TNameMap<int> Map;
+		assert(Map.empty() && Map.begin() == Map.end());
+		auto [Inserted, IsNew] = Map.insert(std::make_pair(std::string_view("One"), 1));
+		assert(IsNew && Inserted->first == "One" && Inserted->second == 1);
+		auto [Converted, IsConvertedNew] = Map.insert(std::pair<std::string, int>("Two", 2));
+		assert(IsConvertedNew && Converted->second == 2);
+		auto [Emplaced, IsEmplacedNew] = Map.emplace("Three", 3);
+		assert(IsEmplacedNew && Emplaced->first == "Three" && Emplaced->second == 3);
+		auto [Existing, IsExistingNew] = Map.emplace("One", 10);
+		assert(!IsExistingNew && Existing->first == "One" && Existing->second == 1);
+		int Defaulted = Map["Four"];
+		assert(Defaulted == 0 && Map.size() == 4);
+		Map["Four"] = 4;
+		assert(Map.find("Four") != Map.end() && Map.find("Four")->second == 4);
+		assert(Map.find("Five") == Map.end() && Map.count("Five") == 0 && Map.count("Two") == 1);
+
+		// the keys are interned, the map doesn't depend on the caller's buffer
+		std::string Temporary = "Temporary";
+		Map.emplace(Temporary, 5);
+		Temporary.assign("Overwritten");
+		assert(Map.count("Temporary") == 1 && Map.count("Overwritten") == 0);
+
+		for (auto& Entry : Map)
+			Entry.second *= 2;
+		const TNameMap<int>& ConstMap = Map;
+		int Sum = 0;
+		size_t Count = 0;
+		for (TNameMap<int>::const_iterator It = ConstMap.begin(); It != ConstMap.end(); ++It)
+		{
+			Sum += It->second;
+			Count++;
+		}
+		assert(Count == ConstMap.size() && Sum == 2 * (1 + 2 + 3 + 4 + 5));
+		assert(ConstMap.find("Three")->second == 6 && ConstMap.find("Six") == ConstMap.end());
+	}
+
+	// interned names across the 4KB blocks and names larger than a block
+	{
+		FNameTable& NameTable = FNameTable::Get();
+		std::vector<std::string> Names;
+		std::vector<std::string_view> Interned;
+		for (uint32_t i = 0; i < 200; i++)
+		{
+			Names.push_back(std::string(90 + i % 20, char('a' + i % 26)) + std::to_string(i));
+			if (i == 100)
+				Names.push_back(std::string(5000, 'L'));
+			if (i == 150)
+				Names.push_back(std::string(4096, 'M'));
+		}
+		for (const std::string& Name : Names)
+		{
+			std::string_view InternedName = NameTable.Intern(Name);
+			assert(InternedName == Name && InternedName.data() != Name.data());
+			Interned.push_back(InternedName);
+		}
+		for (size_t i = 0; i < Names.size(); i++)
+		{
+			assert(Interned[i] == Names[i]);
+			std::string_view Reinterned = NameTable.Intern(Names[i]);
+			assert(Reinterned.data() == Interned[i].data());
+		}
+	}
+	printf("TestNameMap Passed\n");
+	return 0;
+}
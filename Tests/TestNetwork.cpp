@@ -29,7 +29,8 @@ int main()
 {
     CoreInitialize();
     {
-        std::thread T1([] {
+        const uint64_t SendPerClient = TestSendCounter;
+        std::thread T1([SendPerClient] {
             CTestEchoServer TestServer;
             TestServer.Run(TEST_PORT);
             uint32_t WaitEventCounter = TestSendCounter * TestClientCounter;
@@ -37,8 +38,21 @@ int main()
             {
                 WaitEventCounter -= TestServer.ProcessEvent();
             }
+            // messages are counted before they are queued to the owner
+            const uint64_t ExpectedMessages = SendPerClient * TestClientCounter;
+            FConnectionOwnerStats Stats = TestServer.GetStats();
+            assert(Stats.Read.MessageCounter == ExpectedMessages && Stats.DroppedMessages == 0);
+            // the clients disconnect once every echo is back, the totals of the destroyed connections are kept
+            while (!Stats.Connections.empty() || Stats.Read.MessageCounter != ExpectedMessages)
+            {
+                TestServer.ProcessEvent();
+                std::this_thread::yield();
+                Stats = TestServer.GetStats();
+            }
+            assert(Stats.Write.MessageCounter == ExpectedMessages && Stats.Write.ByteCounter == Stats.Read.ByteCounter);
+            assert(Stats.SendQueueMessages == 0 && Stats.SendQueueBytes == 0);
             });
-        std::thread T2([] {
+        std::thread T2([SendPerClient] {
             std::vector<std::unique_ptr<CClient>> Clients;
             std::vector<std::future<std::shared_ptr<SConnection>>> ClientFutureConnections;
             std::vector<std::shared_ptr<SConnection>> ClientConnections;
@@ -77,6 +91,18 @@ int main()
                     WaitEventCounter -= (*it)->ProcessEvent();
                 }
             }
+            // every echo is read, the completion of the last write may still be running
+            for (auto& Connection : ClientConnections)
+            {
+                FConnectionStats Stats = Connection->GetStats();
+                while (Stats.Write.MessageCounter != SendPerClient || Stats.SendQueueMessages != 0)
+                {
+                    std::this_thread::yield();
+                    Stats = Connection->GetStats();
+                }
+                assert(Stats.Read.MessageCounter == SendPerClient && Stats.Read.ByteCounter == Stats.Write.ByteCounter);
+                assert(Stats.SendQueueBytes == 0 && Stats.MaxSendQueueMessages >= 1 && Stats.DroppedMessages == 0);
+            }
             ClientConnections.clear();
             Clients.clear();
             });
@@ -0,0 +1,119 @@
+#include "ReflectSerializer.h"
+#include "Core.h"
+#include <cassert>
+#include <cstddef>
+
+enum class ETestColor : Int16 { Red = -1, Green = 2 };
+
+struct FTestInner
+{
+	Int32 Id;
+	std::string Name;
+};
+
+struct FTestOuter
+{
+	Bool Enabled;
+	Uint64 Counter;
+	Int64 Delta;
+	Double Ratio;
+	Float Values[3];
+	ETestColor Color;
+	FTestInner Inner;
+	std::vector<Int32> Numbers;
+	std::vector<std::string> Tags;
+};
+
+int main()
+{
+	CoreInitialize();
+	{
+		FClass InnerClass("FTestInner");
+		InnerClass.Size = sizeof(FTestInner);
+		FInt32Property InnerId("Id", EPF_NoneFlag, offsetof(FTestInner, Id));
+		FStringProperty InnerName("Name", EPF_NoneFlag, offsetof(FTestInner, Name));
+		InnerClass.Properties = { &InnerId, &InnerName };
+
+		FEnum ColorEnum("ETestColor");
+		ColorEnum.Size = sizeof(ETestColor);
+
+		FClass OuterClass("FTestOuter");
+		OuterClass.Size = sizeof(FTestOuter);
+		FBoolProperty Enabled("Enabled", EPF_NoneFlag, offsetof(FTestOuter, Enabled));
+		FUInt64Property Counter("Counter", EPF_NoneFlag, offsetof(FTestOuter, Counter));
+		FInt64Property Delta("Delta", EPF_NoneFlag, offsetof(FTestOuter, Delta));
+		FDoubleProperty Ratio("Ratio", EPF_NoneFlag, offsetof(FTestOuter, Ratio));
+		FFloatProperty Values("Values", EPF_NoneFlag, offsetof(FTestOuter, Values), 3);
+		FEnumProperty Color("Color", EPF_NoneFlag, offsetof(FTestOuter, Color));
+		Color.Meta = &ColorEnum;
+		FClassProperty Inner("Inner", EPF_StructFlag, offsetof(FTestOuter, Inner));
+		Inner.Meta = &InnerClass;
+		FInt32Property Numbers("Numbers", EPF_ArrayFlag, offsetof(FTestOuter, Numbers));
+		FStringProperty Tags("Tags", EPF_ArrayFlag, offsetof(FTestOuter, Tags));
+		OuterClass.Properties = { &Enabled, &Counter, &Delta, &Ratio, &Values, &Color, &Inner, &Numbers, &Tags };
+
+		FTestOuter Source{ true, 300, -5, 0.25, { 1.f, 2.f, 3.f }, ETestColor::Red, { 7, "Inner" }, { -1, 0, 100000 }, { "A", "", "Tag" } };
+		FMessageData MessageData;
+		bool Serialized = FReflectSerializer::Serialize(&OuterClass, &Source, MessageData);
+		assert(Serialized);
+
+		FTestOuter Target{};
+		bool Deserialized = FReflectSerializer::Deserialize(&OuterClass, &Target, MessageData);
+		assert(Deserialized);
+		assert(Target.Enabled == Source.Enabled && Target.Counter == Source.Counter && Target.Delta == Source.Delta && Target.Ratio == Source.Ratio);
+		assert(Target.Values[2] == Source.Values[2] && Target.Color == Source.Color);
+		assert(Target.Inner.Id == Source.Inner.Id && Target.Inner.Name == Source.Inner.Name);
+		assert(Target.Numbers == Source.Numbers && Target.Tags == Source.Tags);
+
+		// truncated body must fail without reading past the end
+		for (uint32_t Size = 0; Size < MessageData.GetBodySize(); Size++)
+		{
+			FTestOuter Truncated{};
+			bool TruncatedDeserialized = FReflectSerializer::Deserialize(&OuterClass, &Truncated, MessageData.GetBody<uint8_t>(), Size);
+			assert(!TruncatedDeserialized);
+		}
+		GLogger->Log(ELogLevel::kInfo, "Serialized Body Size {:d}", MessageData.GetBodySize());
+
+		// a newer peer dropped Delta, added Extra and reordered its fields
+		struct FTestOuterV2
+		{
+			Int32 Extra;
+			FTestInner Inner;
+			Uint64 Counter;
+		};
+		FClass OuterClassV2("FTestOuter");
+		OuterClassV2.Size = sizeof(FTestOuterV2);
+		FInt32Property Extra("Extra", EPF_NoneFlag, offsetof(FTestOuterV2, Extra));
+		FClassProperty InnerV2("Inner", EPF_StructFlag, offsetof(FTestOuterV2, Inner));
+		InnerV2.Meta = &InnerClass;
+		FUInt64Property CounterV2("Counter", EPF_NoneFlag, offsetof(FTestOuterV2, Counter));
+		OuterClassV2.Properties = { &Extra, &InnerV2, &CounterV2 };
+
+		std::vector<uint8_t> Schema;
+		bool SchemaSerialized = FReflectSerializer::SerializeSchema(&OuterClass, Schema);
+		assert(SchemaSerialized);
+		FReflectPeerSchema PeerSchema;
+		bool SchemaAdded = PeerSchema.AddSchema(Schema.data(), Schema.size());
+		assert(SchemaAdded);
+
+		FMessageData TaggedData;
+		bool TaggedSerialized = FReflectSerializer::SerializeTagged(&OuterClass, &Source, TaggedData);
+		assert(TaggedSerialized);
+		for (FReflectPeerSchema* Peer : { (FReflectPeerSchema*)nullptr, &PeerSchema })
+		{
+			FTestOuterV2 TargetV2{ 42 };
+			bool TaggedDeserialized = FReflectSerializer::DeserializeTagged(&OuterClassV2, &TargetV2, TaggedData, Peer);
+			assert(TaggedDeserialized);
+			assert(TargetV2.Extra == 42 && TargetV2.Counter == Source.Counter);
+			assert(TargetV2.Inner.Id == Source.Inner.Id && TargetV2.Inner.Name == Source.Inner.Name);
+		}
+		for (uint32_t Size = 0; Size < TaggedData.GetBodySize(); Size++)
+		{
+			FTestOuterV2 Truncated{};
+			// must not read past the end, a cut between two fields is a valid message of an older peer
+			FReflectSerializer::DeserializeTagged(&OuterClassV2, &Truncated, TaggedData.GetBody<uint8_t>(), Size, &PeerSchema);
+		}
+		GLogger->Log(ELogLevel::kInfo, "Tagged Body Size {:d}", TaggedData.GetBodySize());
+	}
+	CoreUninitialize();
+}
@@ -0,0 +1,109 @@
+#include "Replication.h"
+#include "Core.h"
+#include <cassert>
+#include <cstddef>
+
+struct FTestVector
+{
+	Float X;
+	Float Y;
+};
+
+struct FTestPlayer
+{
+	Uint32 Health;
+	Int64 Score;
+	std::string Name;
+	FTestVector Position;
+	Bool Alive;
+	Int32 Slots[4];
+};
+
+int main()
+{
+	CoreInitialize();
+	{
+		FClass VectorClass("FTestVector");
+		VectorClass.Size = sizeof(FTestVector);
+		FFloatProperty X("X", EPF_NoneFlag, offsetof(FTestVector, X));
+		FFloatProperty Y("Y", EPF_NoneFlag, offsetof(FTestVector, Y));
+		VectorClass.Properties = { &X, &Y };
+
+		FClass PlayerClass("FTestPlayer");
+		PlayerClass.Size = sizeof(FTestPlayer);
+		FUInt32Property Health("Health", EPF_NoneFlag, offsetof(FTestPlayer, Health));
+		FInt64Property Score("Score", EPF_NoneFlag, offsetof(FTestPlayer, Score));
+		FStringProperty Name("Name", EPF_NoneFlag, offsetof(FTestPlayer, Name));
+		FClassProperty Position("Position", EPF_StructFlag, offsetof(FTestPlayer, Position));
+		Position.Meta = &VectorClass;
+		FBoolProperty Alive("Alive", EPF_NoneFlag, offsetof(FTestPlayer, Alive));
+		FInt32Property Slots("Slots", EPF_NoneFlag, offsetof(FTestPlayer, Slots), 4);
+		PlayerClass.Properties = { &Health, &Score, &Name, &Position, &Alive, &Slots };
+
+		FReplicationSender Sender(&PlayerClass);
+		FReplicationReceiver Receiver(&PlayerClass);
+		FTestPlayer Source{ 100, -20, "Player", { 1.5f, -2.f }, true, { 1, 2, 3, 4 } };
+		FTestPlayer Target{};
+
+		// nothing acked, the first delta carry every field
+		FMessageData Delta;
+		bool Built = Sender.BuildDelta(&Source, Delta);
+		assert(Built);
+		uint32_t FullSize = Delta.GetBodySize();
+		bool Applied = Receiver.Apply(&Target, Delta);
+		assert(Applied);
+		assert(Target.Health == 100 && Target.Score == -20 && Target.Name == "Player" && Target.Alive);
+		assert(Target.Position.X == 1.5f && Target.Position.Y == -2.f && Target.Slots[3] == 4);
+
+		FMessageData Ack;
+		bool AckBuilt = Receiver.BuildAck(Ack);
+		assert(AckBuilt);
+		bool Acknowledged = Sender.Acknowledge(Ack);
+		assert(Acknowledged && Sender.GetPendingDeltaCount() == 0);
+		assert(!Sender.BuildDelta(&Source, Delta));
+
+		// one changed field against the acked state
+		Source.Position.Y = 3.f;
+		Built = Sender.BuildDelta(&Source, Delta);
+		assert(Built && Delta.GetBodySize() < FullSize);
+
+		// a field changed back before the ack is sent again, the peer may hold the value of the previous delta
+		Source.Slots[1] = 7;
+		FMessageData SecondDelta;
+		Sender.BuildDelta(&Source, SecondDelta);
+		Applied = Receiver.Apply(&Target, Delta) && Receiver.Apply(&Target, SecondDelta);
+		assert(Applied && Target.Position.Y == 3.f && Target.Slots[1] == 7);
+		Source.Slots[1] = 2;
+		FMessageData ThirdDelta;
+		Sender.BuildDelta(&Source, ThirdDelta);
+		Applied = Receiver.Apply(&Target, ThirdDelta);
+		assert(Applied && Target.Slots[1] == 2);
+
+		// truncated deltas are rejected without touching the object
+		for (uint32_t Size = 0; Size < ThirdDelta.GetBodySize(); Size++)
+		{
+			FTestPlayer Truncated{};
+			bool TruncatedApplied = Receiver.Apply(&Truncated, ThirdDelta.GetBody<uint8_t>(), Size);
+			assert(!TruncatedApplied && Truncated.Health == 0);
+		}
+
+		// same field names and types with another array size or another nesting is another layout
+		FClass ShorterClass("FTestPlayer");
+		ShorterClass.Size = sizeof(FTestPlayer);
+		FInt32Property ShorterSlots("Slots", EPF_NoneFlag, offsetof(FTestPlayer, Slots), 3);
+		ShorterClass.Properties = { &Health, &Score, &Name, &Position, &Alive, &ShorterSlots };
+		FClass FlatClass("FTestPlayer");
+		FlatClass.Size = sizeof(FTestPlayer);
+		FFloatProperty FlatX("X", EPF_NoneFlag, offsetof(FTestPlayer, Position) + offsetof(FTestVector, X));
+		FFloatProperty FlatY("Y", EPF_NoneFlag, offsetof(FTestPlayer, Position) + offsetof(FTestVector, Y));
+		FlatClass.Properties = { &Health, &Score, &Name, &FlatX, &FlatY, &Alive, &Slots };
+		FReplicationSender FreshSender(&PlayerClass);
+		FMessageData FreshDelta;
+		FreshSender.BuildDelta(&Source, FreshDelta);
+		FTestPlayer Other{};
+		assert(!FReplicationReceiver(&ShorterClass).Apply(&Other, FreshDelta) && Other.Health == 0);
+		assert(!FReplicationReceiver(&FlatClass).Apply(&Other, FreshDelta) && Other.Health == 0);
+		GLogger->Log(ELogLevel::kInfo, "Full Delta Size {:d}, Changed Delta Size {:d}", FullSize, Delta.GetBodySize());
+	}
+	CoreUninitialize();
+}
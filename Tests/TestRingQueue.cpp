@@ -0,0 +1,109 @@
+#include "RingQueue.h"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+constexpr uint64_t TestElementCounter = 1 << 18;
+constexpr uint32_t TestBulkSize = 16;
+
+struct FTestResult
+{
+	uint64_t Count;
+	uint64_t Sum;
+	uint64_t Xor;
+};
+
+// every producer push the values [Producer * TestElementCounter, (Producer + 1) * TestElementCounter), half of them in bulk
+// a small capacity keep the queue full or empty most of the time, so the claims race on the cursors
+template<EQueueMode::Type Mode>
+void TestRingQueue(uint32_t ProducerCounter, uint32_t ConsumerCounter)
+{
+	TRingQueue<uint64_t, Mode> Queue(64);
+	std::atomic<uint64_t> DequeueCounter{ 0 };
+	uint64_t TotalCounter = TestElementCounter * ProducerCounter;
+	std::vector<FTestResult> Results(ConsumerCounter, FTestResult{ 0, 0, 0 });
+	std::vector<std::thread> Threads;
+	for (uint32_t i = 0; i < ProducerCounter; i++)
+	{
+		Threads.emplace_back([&Queue, i] {
+			uint64_t Value = uint64_t(i) * TestElementCounter;
+			uint64_t End = Value + TestElementCounter;
+			uint64_t Bulk[TestBulkSize];
+			while (Value < End)
+			{
+				if (Value & TestBulkSize)
+				{
+					uint32_t Count = uint32_t((std::min)(uint64_t(TestBulkSize), End - Value));
+					for (uint32_t j = 0; j < Count; j++)
+						Bulk[j] = Value + j;
+					Count = Queue.EnqueueBulk(Bulk, Count);
+					if (Count == 0)
+						std::this_thread::yield();
+					Value += Count;
+				}
+				else if (Queue.Enqueue(Value))
+				{
+					Value++;
+				}
+				else
+				{
+					std::this_thread::yield();
+				}
+			}
+			});
+	}
+	for (uint32_t i = 0; i < ConsumerCounter; i++)
+	{
+		Threads.emplace_back([&, i] {
+			FTestResult& Result = Results[i];
+			uint64_t Bulk[TestBulkSize];
+			while (DequeueCounter.load(std::memory_order_relaxed) < TotalCounter)
+			{
+				uint32_t Count = 0;
+				if (Result.Count & 1)
+					Count = Queue.DequeueBulk(Bulk, TestBulkSize);
+				else if (Queue.Dequeue(Bulk[0]))
+					Count = 1;
+				if (Count == 0)
+					std::this_thread::yield();
+				for (uint32_t j = 0; j < Count; j++)
+				{
+					Result.Sum += Bulk[j];
+					Result.Xor ^= Bulk[j] * 0x9E3779B97F4A7C15ull;
+				}
+				Result.Count += Count;
+				DequeueCounter.fetch_add(Count, std::memory_order_relaxed);
+			}
+			});
+	}
+	for (std::thread& Thread : Threads)
+		Thread.join();
+
+	FTestResult Expected{ TotalCounter, 0, 0 };
+	for (uint64_t Value = 0; Value < TotalCounter; Value++)
+	{
+		Expected.Sum += Value;
+		Expected.Xor ^= Value * 0x9E3779B97F4A7C15ull;
+	}
+	FTestResult Total{ 0, 0, 0 };
+	for (const FTestResult& Result : Results)
+	{
+		Total.Count += Result.Count;
+		Total.Sum += Result.Sum;
+		Total.Xor ^= Result.Xor;
+	}
+	assert(Total.Count == Expected.Count && Total.Sum == Expected.Sum && Total.Xor == Expected.Xor);
+	assert(Queue.IsEmpty());
+	printf("%u producers %u consumers: %llu elements\n", ProducerCounter, ConsumerCounter, (unsigned long long)Total.Count);
+}
+
+int main()
+{
+	TestRingQueue<EQueueMode::SPSC>(1, 1);
+	TestRingQueue<EQueueMode::MPSC>(4, 1);
+	TestRingQueue<EQueueMode::MPMC>(4, 4);
+	return 0;
+}
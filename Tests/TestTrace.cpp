@@ -0,0 +1,202 @@
+#include "Trace.h"
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+// minimal recursive descent JSON validator
+struct FJsonValidator
+{
+	bool Validate()
+	{
+		return ParseValue() && (SkipSpaces(), It == End);
+	}
+
+	void SkipSpaces()
+	{
+		while (It != End && (*It == ' ' || *It == '\n' || *It == '\r' || *It == '\t'))
+			It++;
+	}
+
+	bool Consume(char Character)
+	{
+		SkipSpaces();
+		if (It == End || *It != Character)
+			return false;
+		It++;
+		return true;
+	}
+
+	bool ParseString()
+	{
+		if (!Consume('"'))
+			return false;
+		for (; It != End && *It != '"'; It++)
+		{
+			if (*It == '\\' && ++It == End)
+				return false;
+			if (uint8_t(*It) < 0x20)
+				return false;
+		}
+		return It++ != End;
+	}
+
+	bool ParseNumber()
+	{
+		const char* Begin = It;
+		if (It != End && *It == '-')
+			It++;
+		while (It != End && ((*It >= '0' && *It <= '9') || *It == '.' || *It == 'e' || *It == 'E' || *It == '+' || *It == '-'))
+			It++;
+		return It != Begin;
+	}
+
+	template<bool bObject>
+	bool ParseContainer()
+	{
+		It++;
+		if (Consume(bObject ? '}' : ']'))
+			return true;
+		do
+		{
+			if (bObject && !(ParseString() && Consume(':')))
+				return false;
+			if (!ParseValue())
+				return false;
+		} while (Consume(','));
+		return Consume(bObject ? '}' : ']');
+	}
+
+	bool ParseValue()
+	{
+		SkipSpaces();
+		if (It == End)
+			return false;
+		if (*It == '{')
+			return ParseContainer<true>();
+		if (*It == '[')
+			return ParseContainer<false>();
+		if (*It == '"')
+			return ParseString();
+		for (std::string_view Literal : { "true", "false", "null" })
+		{
+			if (std::string_view(It, End - It).starts_with(Literal))
+			{
+				It += Literal.size();
+				return true;
+			}
+		}
+		return ParseNumber();
+	}
+
+	const char* It;
+	const char* End;
+};
+
+static bool IsValidJson(const std::string& Json)
+{
+	FJsonValidator Validator{ Json.data(), Json.data() + Json.size() };
+	return Validator.Validate();
+}
+
+static size_t CountOf(const std::string& String, const std::string& Pattern)
+{
+	size_t Count = 0;
+	for (size_t Position = String.find(Pattern); Position != std::string::npos; Position = String.find(Pattern, Position + 1))
+		Count++;
+	return Count;
+}
+
+// values of the counter events named Name, in the order of the trace
+static std::vector<int64_t> GetCounterValues(const std::string& Json, const std::string& Name)
+{
+	std::vector<int64_t> Values;
+	const std::string Key = "{\"name\":\"" + Name + "\"";
+	for (size_t Position = Json.find(Key); Position != std::string::npos; Position = Json.find(Key, Position + 1))
+	{
+		size_t ValuePosition = Json.find("\"value\":", Position);
+		assert(ValuePosition != std::string::npos);
+		Values.push_back(strtoll(Json.c_str() + ValuePosition + 8, nullptr, 10));
+	}
+	return Values;
+}
+
+int main()
+{
+	FTrace::Clear();
+	TRACE_THREAD_NAME("Main \"Thread\"");
+
+	// nothing is recorded until Start
+	FTrace::Instant("Stopped");
+	std::string Json = FTrace::ToChromeTrace();
+	assert(IsValidJson(Json));
+	assert(CountOf(Json, "Stopped") == 0 && CountOf(Json, "Main \\\"Thread\\\"") == 1);
+
+	// the wrapped buffer keep the newest events, the slot being written excluded
+	FTrace::Start();
+	const int64_t EventCount = TRACE_THREAD_BUFFER_CAPACITY + 100;
+	for (int64_t i = 0; i < EventCount; i++)
+		FTrace::Counter("Wrapped", i);
+	Json = FTrace::ToChromeTrace();
+	assert(IsValidJson(Json));
+	std::vector<int64_t> Values = GetCounterValues(Json, "Wrapped");
+	assert(Values.size() == TRACE_THREAD_BUFFER_CAPACITY - 1);
+	for (size_t i = 0; i < Values.size(); i++)
+		assert(Values[i] == EventCount - int64_t(Values.size()) + int64_t(i));
+
+	// Clear drop the events and the buffers of exited threads
+	std::thread([] {
+		TRACE_THREAD_NAME("Exited");
+		TRACE_INSTANT("ExitedInstant");
+		}).join();
+	assert(CountOf(FTrace::ToChromeTrace(), "ExitedInstant") == 1);
+	FTrace::Clear();
+	Json = FTrace::ToChromeTrace();
+	assert(IsValidJson(Json));
+	assert(CountOf(Json, "Wrapped") == 0 && CountOf(Json, "Exited") == 0);
+	assert(CountOf(Json, "Main \\\"Thread\\\"") == 1);
+
+	// a scope begun before Stop still end, a scope begun before Start doesn't
+	{
+		TRACE_SCOPE("Stopping");
+		FTrace::Stop();
+	}
+	{
+		TRACE_SCOPE("Starting");
+		FTrace::Start();
+	}
+	Json = FTrace::ToChromeTrace();
+	assert(IsValidJson(Json));
+	assert(CountOf(Json, "{\"name\":\"Stopping\",\"cat\":\"Core\",\"ph\":\"B\"") == 1);
+	assert(CountOf(Json, "{\"name\":\"Stopping\",\"cat\":\"Core\",\"ph\":\"E\"") == 1);
+	assert(CountOf(Json, "Starting") == 0);
+
+	// exports taken while another thread wraps its buffer only hold intact, consecutive events
+	FTrace::Clear();
+	std::atomic<bool> Running{ true };
+	std::thread Writer([&Running] {
+		TRACE_THREAD_NAME("Writer");
+		for (int64_t i = 0; Running.load(std::memory_order_relaxed); i++)
+			TRACE_COUNTER("Concurrent", i);
+		});
+	for (uint32_t i = 0; i < 20; i++)
+	{
+		Json = FTrace::ToChromeTrace();
+		assert(IsValidJson(Json));
+		Values = GetCounterValues(Json, "Concurrent");
+		assert(Values.size() < TRACE_THREAD_BUFFER_CAPACITY);
+		for (size_t j = 1; j < Values.size(); j++)
+			assert(Values[j] == Values[j - 1] + 1);
+		std::this_thread::yield();
+	}
+	Running = false;
+	Writer.join();
+	FTrace::Stop();
+	FTrace::Clear();
+
+	printf("TestTrace Passed\n");
+	return 0;
+}